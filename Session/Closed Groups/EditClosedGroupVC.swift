@@ -72,14 +72,11 @@ final class EditClosedGroupVC : BaseVC, UITableViewDataSource, UITableViewDelega
         let backButton = UIBarButtonItem(title: "Back", style: .plain, target: nil, action: nil)
         backButton.tintColor = Colors.text
         navigationItem.backBarButtonItem = backButton
-        func getDisplayName(for publicKey: String) -> String {
-            return Storage.shared.getContact(with: publicKey)?.displayName(for: .regular) ?? publicKey
-        }
         setUpViewHierarchy()
         // Always show zombies at the bottom
         zombies = Storage.shared.getZombieMembers(for: groupPublicKey)
-        membersAndZombies = GroupUtilities.getClosedGroupMembers(thread).sorted { getDisplayName(for: $0) < getDisplayName(for: $1) }
-            + zombies.sorted { getDisplayName(for: $0) < getDisplayName(for: $1) }
+        membersAndZombies = ContactUtilities.sortedByDisplayName(GroupUtilities.getClosedGroupMembers(thread))
+            + ContactUtilities.sortedByDisplayName(zombies)
         updateNavigationBarButtons()
         name = thread.groupModel.groupName!
     }
@@ -245,10 +242,7 @@ final class EditClosedGroupVC : BaseVC, UITableViewDataSource, UITableViewDelega
             guard let self = self else { return }
             var members = self.membersAndZombies
             members.append(contentsOf: selectedUsers)
-            func getDisplayName(for publicKey: String) -> String {
-                return Storage.shared.getContact(with: publicKey)?.displayName(for: .regular) ?? publicKey
-            }
-            self.membersAndZombies = members.sorted { getDisplayName(for: $0) < getDisplayName(for: $1) }
+            self.membersAndZombies = ContactUtilities.sortedByDisplayName(members)
             let hasContactsToAdd = !Set(ContactUtilities.getAllContacts()).subtracting(self.membersAndZombies).isEmpty
             self.addMembersButton.isUserInteractionEnabled = hasContactsToAdd
             let color = hasContactsToAdd ? Colors.accent : Colors.text.withAlphaComponent(Values.mediumOpacity)
@@ -182,6 +182,11 @@ extension ConversationVC : InputViewDelegate, MessageCellDelegate, ContextMenuAc
             let dataSource = DataSourcePath.dataSource(with: url, shouldDeleteOnDeallocation: false)!
             dataSource.sourceFilename = fileName
             let compressionResult: SignalAttachment.VideoCompressionResult = SignalAttachment.compressVideoAsMp4(dataSource: dataSource, dataUTI: kUTTypeMPEG4 as String)
+            DispatchQueue.main.async {
+                // Stop transcoding if the user cancels (or already has)
+                guard !modalActivityIndicator.wasCancelled else { compressionResult.transcoder?.cancel(); return }
+                modalActivityIndicator.onCancel = { compressionResult.transcoder?.cancel() }
+            }
             compressionResult.attachmentPromise.done { attachment in
                 guard !modalActivityIndicator.wasCancelled, let attachment = attachment as? SignalAttachment else { return }
                 modalActivityIndicator.dismiss {
@@ -209,6 +209,7 @@ final class ConversationVC : BaseVC, ConversationViewModelDelegate, OWSConversat
         notificationCenter.addObserver(self, selector: #selector(handleMessageSentStatusChanged), name: .messageSentStatusDidChange, object: nil)
         // Mentions
         MentionsManager.populateUserPublicKeyCacheIfNeeded(for: thread.uniqueId!)
+        MentionsManager.buildCandidateIndexIfNeeded(for: thread.uniqueId!)
         // Draft
         var draft = ""
         Storage.read { transaction in
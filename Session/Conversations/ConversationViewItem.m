@@ -353,8 +353,8 @@ NSString *NSStringForOWSMessageCellType(OWSMessageCellType cellType)
 
 #pragma mark - Displayable Text
 
-// TODO: Now that we're caching the displayable text on the view items,
-//       I don't think we need this cache any more.
+// Oversize text is read from disk, so the result is cached per interaction. Other texts go through
+// DisplayableText's own content-keyed cache.
 - (NSCache *)displayableTextCache
 {
     static NSCache *cache = nil;
@@ -372,12 +372,7 @@ NSString *NSStringForOWSMessageCellType(OWSMessageCellType cellType)
     OWSAssertDebug(text);
     OWSAssertDebug(interactionId.length > 0);
 
-    NSString *displayableTextCacheKey = [@"body-" stringByAppendingString:interactionId];
-
-    return [self displayableTextForCacheKey:displayableTextCacheKey
-                                  textBlock:^{
-                                      return text;
-                                  }];
+    return [DisplayableText displayableText:text];
 }
 
 - (DisplayableText *)displayableBodyTextForOversizeTextAttachment:(TSAttachmentStream *)attachmentStream
@@ -403,12 +398,7 @@ NSString *NSStringForOWSMessageCellType(OWSMessageCellType cellType)
     OWSAssertDebug(text);
     OWSAssertDebug(interactionId.length > 0);
 
-    NSString *displayableTextCacheKey = [@"quoted-" stringByAppendingString:interactionId];
-
-    return [self displayableTextForCacheKey:displayableTextCacheKey
-                                  textBlock:^{
-                                      return text;
-                                  }];
+    return [DisplayableText displayableText:text];
 }
 
 - (DisplayableText *)displayableCaptionForText:(NSString *)text attachmentId:(NSString *)attachmentId
@@ -416,12 +406,7 @@ NSString *NSStringForOWSMessageCellType(OWSMessageCellType cellType)
     OWSAssertDebug(text);
     OWSAssertDebug(attachmentId.length > 0);
 
-    NSString *displayableTextCacheKey = [@"attachment-caption-" stringByAppendingString:attachmentId];
-
-    return [self displayableTextForCacheKey:displayableTextCacheKey
-                                  textBlock:^{
-                                      return text;
-                                  }];
+    return [DisplayableText displayableText:text];
 }
 
 - (DisplayableText *)displayableTextForCacheKey:(NSString *)displayableTextCacheKey
@@ -12,4 +12,10 @@ public class GiphyDownloader: ProxiedContentDownloader {
 
     @objc
     public static let giphyDownloader = GiphyDownloader(downloadFolderName: "GIFs")
+
+    // Keep GIFs on disk across launches so that scrolling back through
+    // the picker, or reopening it, doesn't download them again.
+    public override class var maxDiskCacheByteCount: UInt {
+        return 100 * 1024 * 1024
+    }
 }
@@ -607,10 +607,6 @@ class MediaGallery: NSObject, MediaGalleryDataSource, MediaTileViewControllerDel
 
     func ensureGalleryItemsLoaded(_ direction: GalleryDirection, item: MediaGalleryItem, amount: UInt, completion: ((IndexSet, [IndexPath]) -> Void)? = nil ) {
 
-        var galleryItems: [MediaGalleryItem] = self.galleryItems
-        var sections: [GalleryDate: [MediaGalleryItem]] = self.sections
-        var sectionDates: [GalleryDate] = self.sectionDates
-
         var newGalleryItems: [MediaGalleryItem] = []
         var newDates: [GalleryDate] = []
 
@@ -681,22 +677,7 @@ class MediaGallery: NSObject, MediaGalleryDataSource, MediaTileViewControllerDel
                             return
                         }
 
-                        let date = item.galleryDate
-
-                        galleryItems.append(item)
-                        if sections[date] != nil {
-                            sections[date]!.append(item)
-
-                            // so we can update collectionView
-                            newGalleryItems.append(item)
-                        } else {
-                            sectionDates.append(date)
-                            sections[date] = [item]
-
-                            // so we can update collectionView
-                            newDates.append(date)
-                            newGalleryItems.append(item)
-                        }
+                        newGalleryItems.append(item)
                     }
 
                     self.fetchedIndexSet = self.fetchedIndexSet.union(unfetchedSet)
@@ -712,36 +693,41 @@ class MediaGallery: NSObject, MediaGalleryDataSource, MediaTileViewControllerDel
             return
         }
 
-        // TODO only sort if changed
-        var sortedSections: [GalleryDate: [MediaGalleryItem]] = [:]
-
-        Bench(title: "sorting gallery items") {
-            galleryItems.sort { lhs, rhs -> Bool in
+        // Only the newly fetched items need to be sorted. They're then merged into the already sorted items and sections,
+        // which keeps the cost of loading a batch proportional to the size of the batch rather than that of the gallery.
+        Bench(title: "merging gallery items") {
+            newGalleryItems.sort { lhs, rhs -> Bool in
                 return lhs.orderingKey < rhs.orderingKey
             }
-            sectionDates.sort()
+            MediaGallery.merge(newGalleryItems, into: &self.galleryItems)
 
-            for (date, galleryItems) in sections {
-                sortedSections[date] = galleryItems.sorted { lhs, rhs -> Bool in
-                    return lhs.orderingKey < rhs.orderingKey
+            var newGalleryItemsByDate: [GalleryDate: [MediaGalleryItem]] = [:]
+            for item in newGalleryItems {
+                newGalleryItemsByDate[item.galleryDate, default: []].append(item)
+            }
+            for (date, items) in newGalleryItemsByDate {
+                if self.sections[date] != nil {
+                    MediaGallery.merge(items, into: &self.sections[date]!)
+                } else {
+                    self.sectionDates.insert(date, at: self.sectionDates.sortedInsertionIndex(for: date) { $0 })
+                    self.sections[date] = items
+
+                    // so we can update collectionView
+                    newDates.append(date)
                 }
             }
         }
 
-        self.galleryItems = galleryItems
-        self.sections = sortedSections
-        self.sectionDates = sectionDates
-
         if let completionBlock = completion {
             Bench(title: "calculating changes for collectionView") {
                 // FIXME can we avoid this index offset?
-                let dateIndices = newDates.map { sectionDates.firstIndex(of: $0)! + 1 }
+                let dateIndices = newDates.map { self.sectionDates.sortedInsertionIndex(for: $0) { $0 } + 1 }
                 let addedSections: IndexSet = IndexSet(dateIndices)
 
                 let addedItems: [IndexPath] = newGalleryItems.map { galleryItem in
-                    let sectionIdx = sectionDates.firstIndex(of: galleryItem.galleryDate)!
-                    let section = sections[galleryItem.galleryDate]!
-                    let itemIdx = section.firstIndex(of: galleryItem)!
+                    let sectionIdx = self.sectionDates.sortedInsertionIndex(for: galleryItem.galleryDate) { $0 }
+                    let section = self.sections[galleryItem.galleryDate]!
+                    let itemIdx = section.sortedIndex(of: galleryItem)!
 
                     // FIXME can we avoid this index offset?
                     return IndexPath(item: itemIdx, section: sectionIdx + 1)
@@ -752,6 +738,36 @@ class MediaGallery: NSObject, MediaGalleryDataSource, MediaTileViewControllerDel
         }
     }
 
+    /// Merges `items` into `sortedItems`, keeping the result sorted by `orderingKey`. Both arrays must already be sorted.
+    private static func merge(_ items: [MediaGalleryItem], into sortedItems: inout [MediaGalleryItem]) {
+        guard let first = items.first, let last = items.last else { return }
+        // Batches are almost always loaded at either end of what's already been loaded
+        if let lastSortedItem = sortedItems.last, !(first.orderingKey < lastSortedItem.orderingKey) {
+            sortedItems.append(contentsOf: items)
+            return
+        }
+        if let firstSortedItem = sortedItems.first, !(firstSortedItem.orderingKey < last.orderingKey) {
+            sortedItems.insert(contentsOf: items, at: 0)
+            return
+        }
+        var result: [MediaGalleryItem] = []
+        result.reserveCapacity(sortedItems.count + items.count)
+        var i = 0
+        var j = 0
+        while i < sortedItems.count && j < items.count {
+            if items[j].orderingKey < sortedItems[i].orderingKey {
+                result.append(items[j])
+                j += 1
+            } else {
+                result.append(sortedItems[i])
+                i += 1
+            }
+        }
+        result.append(contentsOf: sortedItems[i...])
+        result.append(contentsOf: items[j...])
+        sortedItems = result
+    }
+
     var dataSourceDelegates: [Weak<MediaGalleryDataSourceDelegate>] = []
     func addDataSourceDelegate(_ dataSourceDelegate: MediaGalleryDataSourceDelegate) {
         dataSourceDelegates.append(Weak(value: dataSourceDelegate))
@@ -787,7 +803,7 @@ class MediaGallery: NSObject, MediaGalleryDataSource, MediaTileViewControllerDel
         let originalSectionDates = self.sectionDates
 
         for item in items {
-            guard let itemIndex = galleryItems.firstIndex(of: item) else {
+            guard let itemIndex = galleryItems.sortedIndex(of: item) else {
                 owsFailDebug("removing unknown item.")
                 return
             }
@@ -804,7 +820,7 @@ class MediaGallery: NSObject, MediaGalleryDataSource, MediaTileViewControllerDel
                 return
             }
 
-            guard let sectionRowIndex = sectionItems.firstIndex(of: item) else {
+            guard let sectionRowIndex = sectionItems.sortedIndex(of: item) else {
                 owsFailDebug("item with unknown sectionRowIndex")
                 return
             }
@@ -820,7 +836,7 @@ class MediaGallery: NSObject, MediaGalleryDataSource, MediaTileViewControllerDel
                 return
             }
 
-            guard let originalSectionRowIndex = originalSectionItems.firstIndex(of: item) else {
+            guard let originalSectionRowIndex = originalSectionItems.sortedIndex(of: item) else {
                 owsFailDebug("item with unknown sectionRowIndex")
                 return
             }
@@ -850,7 +866,7 @@ class MediaGallery: NSObject, MediaGalleryDataSource, MediaTileViewControllerDel
 
         self.ensureGalleryItemsLoaded(.after, item: currentItem, amount: kGallerySwipeLoadBatchSize)
 
-        guard let currentIndex = galleryItems.firstIndex(of: currentItem) else {
+        guard let currentIndex = galleryItems.sortedIndex(of: currentItem) else {
             owsFailDebug("currentIndex was unexpectedly nil")
             return nil
         }
@@ -874,7 +890,7 @@ class MediaGallery: NSObject, MediaGalleryDataSource, MediaTileViewControllerDel
 
         self.ensureGalleryItemsLoaded(.before, item: currentItem, amount: kGallerySwipeLoadBatchSize)
 
-        guard let currentIndex = galleryItems.firstIndex(of: currentItem) else {
+        guard let currentIndex = galleryItems.sortedIndex(of: currentItem) else {
             owsFailDebug("currentIndex was unexpectedly nil")
             return nil
         }
@@ -901,3 +917,34 @@ class MediaGallery: NSObject, MediaGalleryDataSource, MediaTileViewControllerDel
         return Int(count) - deletedAttachments.count
     }
 }
+
+// MARK: - Sorted Lookups
+
+extension Array {
+
+    /// Returns the index at which an element with the given key would have to be inserted to keep the array sorted. The
+    /// array must already be sorted by `key`.
+    func sortedInsertionIndex<Key: Comparable>(for key: Key, by getKey: (Element) -> Key) -> Int {
+        var lowerBound = 0
+        var upperBound = count
+        while lowerBound < upperBound {
+            let middle = (lowerBound + upperBound) / 2
+            if getKey(self[middle]) < key {
+                lowerBound = middle + 1
+            } else {
+                upperBound = middle
+            }
+        }
+        return lowerBound
+    }
+}
+
+extension Array where Element == MediaGalleryItem {
+
+    /// The index of `item` in an array sorted by `orderingKey`, found in O(log n).
+    func sortedIndex(of item: MediaGalleryItem) -> Int? {
+        let index = sortedInsertionIndex(for: item.orderingKey) { $0.orderingKey }
+        guard let candidate = self[safe: index], candidate == item else { return nil }
+        return index
+    }
+}
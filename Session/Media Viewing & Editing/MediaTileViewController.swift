@@ -8,7 +8,7 @@ public protocol MediaTileViewControllerDelegate: class {
     func mediaTileViewController(_ viewController: MediaTileViewController, didTapView tappedView: UIView, mediaGalleryItem: MediaGalleryItem)
 }
 
-public class MediaTileViewController: UICollectionViewController, MediaGalleryDataSourceDelegate, UICollectionViewDelegateFlowLayout {
+public class MediaTileViewController: UICollectionViewController, MediaGalleryDataSourceDelegate, UICollectionViewDelegateFlowLayout, UICollectionViewDataSourcePrefetching {
 
     private weak var mediaGalleryDataSource: MediaGalleryDataSource?
 
@@ -99,6 +99,7 @@ public class MediaTileViewController: UICollectionViewController, MediaGalleryDa
         collectionView.register(MediaGalleryStaticHeader.self, forSupplementaryViewOfKind: UICollectionView.elementKindSectionHeader, withReuseIdentifier: MediaGalleryStaticHeader.reuseIdentifier)
 
         collectionView.delegate = self
+        collectionView.prefetchDataSource = self
 
         // feels a bit weird to have content smashed all the way to the bottom edge.
         collectionView.contentInset = UIEdgeInsets(top: 0, left: 0, bottom: 20, right: 0)
@@ -113,10 +114,11 @@ public class MediaTileViewController: UICollectionViewController, MediaGalleryDa
     }
 
     private func indexPath(galleryItem: MediaGalleryItem) -> IndexPath? {
-        guard let sectionIdx = galleryDates.firstIndex(of: galleryItem.galleryDate) else {
+        let sectionIdx = galleryDates.sortedInsertionIndex(for: galleryItem.galleryDate) { $0 }
+        guard galleryDates[safe: sectionIdx] == galleryItem.galleryDate else {
             return nil
         }
-        guard let rowIdx = galleryItems[galleryItem.galleryDate]!.firstIndex(of: galleryItem) else {
+        guard let rowIdx = galleryItems[galleryItem.galleryDate]!.sortedIndex(of: galleryItem) else {
             return nil
         }
 
@@ -377,7 +379,7 @@ public class MediaTileViewController: UICollectionViewController, MediaGalleryDa
                 return defaultCell
             }
 
-            let gridCellItem = GalleryGridCellItem(galleryItem: galleryItem)
+            let gridCellItem = GalleryGridCellItem(galleryItem: galleryItem, thumbnailCache: thumbnailCache)
             cell.configure(item: gridCellItem)
 
             return cell
@@ -403,6 +405,27 @@ public class MediaTileViewController: UICollectionViewController, MediaGalleryDa
         return galleryItem
     }
 
+    // MARK: UICollectionViewDataSourcePrefetching
+
+    // Thumbnails of the cells that are about to scroll into view are loaded ahead of time. The cache is bounded by the
+    // decoded size of the thumbnails so that scrolling through a large gallery doesn't hold on to every thumbnail it's seen.
+    let kThumbnailPrefetchByteBudget: Int = 32 * 1024 * 1024
+    private lazy var thumbnailCache: NSCache<NSString, UIImage> = {
+        let cache = NSCache<NSString, UIImage>()
+        cache.totalCostLimit = kThumbnailPrefetchByteBudget
+        return cache
+    }()
+
+    public func collectionView(_ collectionView: UICollectionView, prefetchItemsAt indexPaths: [IndexPath]) {
+        for indexPath in indexPaths {
+            guard indexPath.section != kLoadOlderSectionIdx, indexPath.section != loadNewerSectionIdx,
+                let galleryItem = galleryItem(at: indexPath) else {
+                continue
+            }
+            GalleryGridCellItem(galleryItem: galleryItem, thumbnailCache: thumbnailCache).prefetchThumbnail()
+        }
+    }
+
     // MARK: UICollectionViewDelegateFlowLayout
 
     static let kInterItemSpacing: CGFloat = 2
@@ -893,9 +916,11 @@ private class MediaGalleryStaticHeader: UICollectionViewCell {
 
 class GalleryGridCellItem: PhotoGridItem {
     let galleryItem: MediaGalleryItem
+    let thumbnailCache: NSCache<NSString, UIImage>?
 
-    init(galleryItem: MediaGalleryItem) {
+    init(galleryItem: MediaGalleryItem, thumbnailCache: NSCache<NSString, UIImage>? = nil) {
         self.galleryItem = galleryItem
+        self.thumbnailCache = thumbnailCache
     }
 
     var type: PhotoGridItemType {
@@ -909,6 +934,28 @@ class GalleryGridCellItem: PhotoGridItem {
     }
 
     func asyncThumbnail(completion: @escaping (UIImage?) -> Void) -> UIImage? {
-        return galleryItem.thumbnailImage(async: completion)
+        guard let thumbnailCache = thumbnailCache, let key = galleryItem.attachmentStream.uniqueId as NSString? else {
+            return galleryItem.thumbnailImage(async: completion)
+        }
+        if let image = thumbnailCache.object(forKey: key) {
+            return image
+        }
+        let image = galleryItem.thumbnailImage(async: { image in
+            GalleryGridCellItem.cache(image, forKey: key, in: thumbnailCache)
+            completion(image)
+        })
+        if let image = image {
+            GalleryGridCellItem.cache(image, forKey: key, in: thumbnailCache)
+        }
+        return image
+    }
+
+    func prefetchThumbnail() {
+        _ = asyncThumbnail(completion: { _ in })
+    }
+
+    private static func cache(_ image: UIImage, forKey key: NSString, in thumbnailCache: NSCache<NSString, UIImage>) {
+        let byteCount = Int(image.size.width * image.scale * image.size.height * image.scale) * 4
+        thumbnailCache.setObject(image, forKey: key, cost: byteCount)
     }
 }
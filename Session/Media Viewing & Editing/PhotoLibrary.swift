@@ -174,22 +174,27 @@ class PhotoCollectionContents {
             let options: PHVideoRequestOptions = PHVideoRequestOptions()
             options.isNetworkAccessAllowed = true
 
-            _ = imageManager.requestExportSession(forVideo: asset, options: options, exportPreset: AVAssetExportPresetMediumQuality) { exportSession, foo in
+            _ = imageManager.requestAVAsset(forVideo: asset, options: options) { avAsset, _, _ in
 
-                guard let exportSession = exportSession else {
-                    resolver.reject(PhotoLibraryError.assertionError(description: "exportSession was unexpectedly nil"))
+                guard let avAsset = avAsset else {
+                    resolver.reject(PhotoLibraryError.assertionError(description: "avAsset was unexpectedly nil"))
                     return
                 }
 
-                exportSession.outputFileType = AVFileType.mp4
-                exportSession.metadataItemFilter = AVMetadataItemFilter.forSharing()
+                // Sized to fit within the attachment size limit, rather than using a fixed preset.
+                let transcoder: VideoTranscoder
+                do {
+                    transcoder = try VideoTranscoder(asset: avAsset, maxByteCount: OWSMediaUtils.kMaxFileSizeVideoBeforeEncryption)
+                } catch {
+                    resolver.reject(error)
+                    return
+                }
 
                 let exportPath = OWSFileSystem.temporaryFilePath(withFileExtension: "mp4")
                 let exportURL = URL(fileURLWithPath: exportPath)
-                exportSession.outputURL = exportURL
 
                 Logger.debug("starting video export")
-                exportSession.exportAsynchronously {
+                transcoder.transcode(to: exportURL).done { _ in
                     Logger.debug("Completed video export")
 
                     guard let dataSource = DataSourcePath.dataSource(with: exportURL, shouldDeleteOnDeallocation: true) else {
@@ -198,6 +203,8 @@ class PhotoCollectionContents {
                     }
 
                     resolver.fulfill((dataSource: dataSource, dataUTI: kUTTypeMPEG4 as String))
+                }.catch { error in
+                    resolver.reject(error)
                 }
             }
         }
@@ -125,6 +125,8 @@ static NSTimeInterval launchStartedAt;
     [self stopPoller];
     [self stopClosedGroupPoller];
     [self stopOpenGroupPollers];
+
+    [self exportMetricsIfNeeded];
 }
 
 - (void)applicationDidReceiveMemoryWarning:(UIApplication *)application
@@ -146,6 +148,8 @@ static NSTimeInterval launchStartedAt;
     // This should be the first thing we do
     SetCurrentAppContext([MainAppContext new]);
 
+    [self configureMetrics];
+
     launchStartedAt = CACurrentMediaTime();
 
     [LKAppModeManager configureWithDelegate:self];
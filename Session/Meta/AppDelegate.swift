@@ -20,6 +20,9 @@ extension AppDelegate {
     func forceSyncConfigurationNowIfNeeded() -> Promise<Void> {
         guard Storage.shared.getUser()?.name != nil,
             let configurationMessage = ConfigurationMessage.getCurrent() else { return Promise.value(()) }
+        // Many UI paths trigger this without the configuration actually having changed; there's no need to send
+        // the same configuration again because the periodic sync keeps the one in the swarm from expiring
+        guard configurationMessage.contentHash != Storage.shared.getLastConfigurationSyncHash() else { return Promise.value(()) }
         let destination = Message.Destination.contact(publicKey: getUserHexEncodedPublicKey())
         let (promise, seal) = Promise<Void>.pending()
         Storage.writeSync { transaction in
@@ -55,5 +58,24 @@ extension AppDelegate {
         let mode = userDefaults.integer(forKey: "appMode")
         return AppMode(rawValue: mode) ?? .light
     }
+
+    /// Metrics are only recorded if the app is launched with the `SESSION_METRICS` environment variable set (e.g. from
+    /// the scheme's run arguments). They're exported to `Caches/Metrics` whenever the app enters the background.
+    @objc func configureMetrics() {
+        Metrics.isEnabled = (ProcessInfo.processInfo.environment["SESSION_METRICS"] != nil)
+    }
+
+    @objc func exportMetricsIfNeeded() {
+        guard Metrics.isEnabled else { return }
+        let directory = URL(fileURLWithPath: OWSFileSystem.cachesDirectoryPath()).appendingPathComponent("Metrics")
+        DispatchQueue.global(qos: .utility).async {
+            do {
+                try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true, attributes: nil)
+                try Metrics.export(to: directory)
+            } catch {
+                SNLog("Couldn't export metrics due to error: \(error).")
+            }
+        }
+    }
     
 }
@@ -46,8 +46,7 @@ public final class BackgroundPoller : NSObject {
                     let promises = messages.compactMap { json -> Promise<Void>? in
                         // Use a best attempt approach here; we don't want to fail the entire process if one of the
                         // messages failed to parse.
-                        guard let envelope = SNProtoEnvelope.from(json),
-                            let data = try? envelope.serializedData() else { return nil }
+                        guard let data = SNProtoEnvelope.serializedData(from: json) else { return nil }
                         let job = MessageReceiveJob(data: data, serverHash: json["hash"] as? String, isBackgroundPoll: true)
                         return job.execute()
                     }
@@ -10,14 +10,20 @@ enum ContactUtilities {
                 result.append(thread.contactSessionID())
             }
         }
-        func getDisplayName(for publicKey: String) -> String {
-            return Storage.shared.getContact(with: publicKey)?.displayName(for: .regular) ?? publicKey
-        }
         // Remove the current user
         if let index = result.firstIndex(of: getUserHexEncodedPublicKey()) {
             result.remove(at: index)
         }
         // Sort alphabetically
-        return result.sorted { getDisplayName(for: $0) < getDisplayName(for: $1) }
+        return sortedByDisplayName(result)
+    }
+
+    /// Sorts the given public keys alphabetically by display name. The contacts are looked up in a single transaction up
+    /// front, rather than once per comparison.
+    static func sortedByDisplayName<S : Sequence>(_ publicKeys: S) -> [String] where S.Element == String {
+        let publicKeys = Array(publicKeys)
+        let contacts = Storage.shared.getContacts(with: Set(publicKeys))
+        let displayNames = publicKeys.map { contacts[$0]?.displayName(for: .regular) ?? $0 }
+        return zip(publicKeys, displayNames).sorted { $0.1 < $1.1 }.map { $0.0 }
     }
 }
@@ -67,7 +67,17 @@ void VerifyRegistrationsForPrimaryStorage(OWSStorage *storage)
         [self loadDatabase];
 
         _dbReadPool = [[YapDatabaseConnectionPool alloc] initWithDatabase:self.database];
+        // Pollers, jobs, the message sender and the UI helpers all read concurrently. Each connection has its own
+        // SQLite handle and object cache, so don't scale past a handful of connections. Default is 3.
+        _dbReadPool.connectionLimit = MAX(3, MIN(NSProcessInfo.processInfo.activeProcessorCount, 6));
+        // The object cache holds deserialized objects (it's separate from SQLite's page cache), so a hit skips both
+        // the row lookup and the NSCoding round trip. Threads, contacts and jobs are read over and over again while
+        // receiving messages, so a larger cache saves a lot of work. Default is 250.
+        _dbReadPool.didCreateNewConnectionBlock = ^(YapDatabaseConnection *connection) {
+            connection.objectCacheLimit = 500;
+        };
         _dbReadWriteConnection = [self newDatabaseConnection];
+        _dbReadWriteConnection.objectCacheLimit = 1000;
         _uiDatabaseConnection = [self newDatabaseConnection];
         
         // Increase object cache limit. Default is 250.
@@ -180,6 +190,8 @@ void VerifyRegistrationsForPrimaryStorage(OWSStorage *storage)
     [OWSMediaGalleryFinder asyncRegisterDatabaseExtensionsWithPrimaryStorage:self];
     [TSDatabaseView asyncRegisterLazyRestoreAttachmentsDatabaseView:self];
 
+    // YapDatabase (re)builds extensions on its write queue, so storage isn't reported as ready until all of them
+    // are done. Otherwise every write, including synchronous ones on the main thread, would stall behind a rebuild.
     [self.database
         flushExtensionRequestsWithCompletionQueue:dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)
                                   completionBlock:^{
@@ -17,11 +17,13 @@
 #import <YapDatabase/YapDatabaseCrossProcessNotification.h>
 #import <YapDatabase/YapDatabaseFullTextSearch.h>
 #import <YapDatabase/YapDatabaseFullTextSearchPrivate.h>
+#import <YapDatabase/YapDatabasePrivate.h>
 #import <YapDatabase/YapDatabaseSecondaryIndex.h>
 #import <YapDatabase/YapDatabaseSecondaryIndexPrivate.h>
 #import <YapDatabase/YapDatabaseSecondaryIndexSetup.h>
 #import <SessionUtilitiesKit/SessionUtilitiesKit.h>
 #import <SessionUtilitiesKit/AppContext.h>
+#import <SessionUtilitiesKit/SessionUtilitiesKit-Swift.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -33,6 +35,7 @@ static NSString *keychainDBLegacyPassphrase = @"TSDatabasePass";
 static NSString *keychainDBCipherKeySpec = @"OWSDatabaseCipherKeySpec";
 
 const NSUInteger kDatabasePasswordLength = 30;
+const unsigned long long kMaxDatabaseWALFileSize = 4 * 1024 * 1024;
 
 typedef NSData *_Nullable (^LoadDatabaseMetadataBlock)(NSError **_Nullable);
 typedef NSData *_Nullable (^CreateDatabaseMetadataBlock)(void);
@@ -335,6 +338,8 @@ NSString *const kNSUserDefaults_DatabaseExtensionVersionMap = @"kNSUserDefaults_
     [OWSPrimaryStorage.sharedManager runAsyncRegistrationsWithCompletion:^{
         [self postRegistrationCompleteNotification];
 
+        [OWSPrimaryStorage.sharedManager logFileSizes];
+
         migrationBlock();
 
         backgroundTask = nil;
@@ -377,8 +382,18 @@ NSString *const kNSUserDefaults_DatabaseExtensionVersionMap = @"kNSUserDefaults_
     // If we want to migrate to the new cipher defaults in SQLCipher4+ we'll need to do a one time
     // migration. See the `PRAGMA cipher_migrate` documentation for details.
     // https://www.zetetic.net/sqlcipher/sqlcipher-api/#cipher_migrate
+    //
+    // Note that we open the database with a raw key spec (see `cipherKeySpecBlock`), so SQLCipher
+    // doesn't run its key derivation function when a connection is opened regardless of these settings.
+    // Memory mapped I/O isn't used for encrypted databases, so there's no point in setting `pragmaMMapSize`.
     options.legacyCipherCompatibilityVersion = 3;
 
+    // Bursts of writes (e.g. while catching up on received messages) can grow the WAL a lot, and readers in the
+    // other processes can prevent it from being checkpointed in the meantime. Checkpoint more aggressively once
+    // the WAL has grown past a few MB, and truncate it afterwards rather than leaving it at its high water mark.
+    options.aggressiveWALTruncationSize = kMaxDatabaseWALFileSize;
+    options.pragmaJournalSizeLimit = kMaxDatabaseWALFileSize;
+
     return options;
 }
 
@@ -405,7 +420,7 @@ NSString *const kNSUserDefaults_DatabaseExtensionVersionMap = @"kNSUserDefaults_
     [self ensureDatabaseKeySpecExists];
 
     OWSDatabase *database = [[OWSDatabase alloc] initWithPath:[self databaseFilePath]
-                                                   serializer:nil
+                                                   serializer:[[self class] compactSerializer]
                                                  deserializer:[[self class] logOnFailureDeserializer]
                                                       options:options
                                                      delegate:self];
@@ -419,6 +434,158 @@ NSString *const kNSUserDefaults_DatabaseExtensionVersionMap = @"kNSUserDefaults_
     return YES;
 }
 
+#pragma mark - Serialization
+
+// Many of the values we store (hashes, timestamps, flags, identifiers, etc.) are plain strings, numbers, dates or data.
+// Keyed archiving these produces a binary plist of a couple of hundred bytes with a lot of allocations on both ends, so
+// instead they're stored in a compact tagged format:
+//
+// [magic (1 byte)] [version (1 byte)] [type (1 byte)] [payload]
+//
+// The payload of strings and data is their raw bytes and the payload of numbers and dates is 8 bytes, little-endian.
+// All other objects are still keyed archived. Keyed archives are binary plists, which start with "bplist", so they can't
+// be mistaken for compact records.
+//
+// Builds without the compact format can't read these records, so for now they're only read. Writing them should only be
+// enabled (by bumping kCompactRecordWriteVersion) once a release that can read them has shipped, so that downgrading
+// never leaves records behind that the older build would fail to decode. Existing records then migrate when they're
+// next written.
+
+static const uint8_t kCompactRecordMagic = 0xC5;
+// The compact record version that's written, or 0 if compact records aren't written yet.
+static const uint8_t kCompactRecordWriteVersion = 0;
+static const uint8_t kCompactRecordVersion = 1;
+static const NSUInteger kCompactRecordHeaderLength = 3;
+
+typedef NS_ENUM(uint8_t, OWSCompactRecordType) {
+    OWSCompactRecordTypeString = 1,
+    OWSCompactRecordTypeData = 2,
+    OWSCompactRecordTypeDate = 3,
+    OWSCompactRecordTypeSignedInteger = 4,
+    OWSCompactRecordTypeUnsignedInteger = 5,
+    OWSCompactRecordTypeDouble = 6,
+    OWSCompactRecordTypeBool = 7,
+};
+
+static NSData *OWSCompactRecordData(OWSCompactRecordType type, const void *payload, NSUInteger payloadLength)
+{
+    NSMutableData *data = [NSMutableData dataWithCapacity:kCompactRecordHeaderLength + payloadLength];
+    uint8_t header[] = { kCompactRecordMagic, kCompactRecordVersion, type };
+    [data appendBytes:header length:kCompactRecordHeaderLength];
+    if (payloadLength > 0) {
+        [data appendBytes:payload length:payloadLength];
+    }
+    return data;
+}
+
+static NSData *OWSCompactRecordData64(OWSCompactRecordType type, uint64_t value)
+{
+    uint64_t littleEndianValue = CFSwapInt64HostToLittle(value);
+    return OWSCompactRecordData(type, &littleEndianValue, sizeof(littleEndianValue));
+}
+
+// Returns nil if the object isn't of a type that can be stored as a compact record.
+static NSData *_Nullable OWSCompactRecordDataForObject(id object)
+{
+    // Compare against the class used for archiving so that e.g. mutable strings, which would be decoded as
+    // immutable strings, are still keyed archived.
+    Class archivedClass = [object classForKeyedArchiver];
+    if (archivedClass == [NSString class]) {
+        NSString *string = object;
+        NSData *utf8Data = [string dataUsingEncoding:NSUTF8StringEncoding];
+        if (!utf8Data) {
+            return nil;
+        }
+        return OWSCompactRecordData(OWSCompactRecordTypeString, utf8Data.bytes, utf8Data.length);
+    } else if (archivedClass == [NSData class]) {
+        NSData *data = object;
+        return OWSCompactRecordData(OWSCompactRecordTypeData, data.bytes, data.length);
+    } else if (archivedClass == [NSDate class]) {
+        NSDate *date = object;
+        Float64 timeInterval = date.timeIntervalSinceReferenceDate;
+        uint64_t bits;
+        memcpy(&bits, &timeInterval, sizeof(bits));
+        return OWSCompactRecordData64(OWSCompactRecordTypeDate, bits);
+    } else if (archivedClass == [NSNumber class]) {
+        NSNumber *number = object;
+        if (CFGetTypeID((__bridge CFTypeRef)number) == CFBooleanGetTypeID()) {
+            uint8_t value = number.boolValue ? 1 : 0;
+            return OWSCompactRecordData(OWSCompactRecordTypeBool, &value, sizeof(value));
+        } else if (CFNumberIsFloatType((__bridge CFNumberRef)number)) {
+            Float64 value = number.doubleValue;
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            return OWSCompactRecordData64(OWSCompactRecordTypeDouble, bits);
+        } else if (strcmp(number.objCType, @encode(unsigned long long)) == 0
+            || strcmp(number.objCType, @encode(unsigned long)) == 0) {
+            return OWSCompactRecordData64(OWSCompactRecordTypeUnsignedInteger, number.unsignedLongLongValue);
+        } else {
+            return OWSCompactRecordData64(OWSCompactRecordTypeSignedInteger, (uint64_t)number.longLongValue);
+        }
+    }
+    return nil;
+}
+
+// Returns nil if the data isn't a valid compact record.
+static id _Nullable OWSObjectForCompactRecordData(NSData *data)
+{
+    const uint8_t *bytes = data.bytes;
+    if (bytes[1] != kCompactRecordVersion) {
+        OWSLogError(@"Unknown compact record version: %d.", bytes[1]);
+        return nil;
+    }
+    const uint8_t *payload = bytes + kCompactRecordHeaderLength;
+    NSUInteger payloadLength = data.length - kCompactRecordHeaderLength;
+    uint64_t value64 = 0;
+    if (payloadLength == sizeof(value64)) {
+        memcpy(&value64, payload, sizeof(value64));
+        value64 = CFSwapInt64LittleToHost(value64);
+    }
+    switch ((OWSCompactRecordType)bytes[2]) {
+        case OWSCompactRecordTypeString:
+            return [[NSString alloc] initWithBytes:payload length:payloadLength encoding:NSUTF8StringEncoding];
+        case OWSCompactRecordTypeData:
+            return [NSData dataWithBytes:payload length:payloadLength];
+        case OWSCompactRecordTypeDate: {
+            if (payloadLength != sizeof(value64)) {
+                return nil;
+            }
+            Float64 timeInterval;
+            memcpy(&timeInterval, &value64, sizeof(timeInterval));
+            return [NSDate dateWithTimeIntervalSinceReferenceDate:timeInterval];
+        }
+        case OWSCompactRecordTypeSignedInteger:
+            return (payloadLength == sizeof(value64)) ? @((long long)value64) : nil;
+        case OWSCompactRecordTypeUnsignedInteger:
+            return (payloadLength == sizeof(value64)) ? @(value64) : nil;
+        case OWSCompactRecordTypeDouble: {
+            if (payloadLength != sizeof(value64)) {
+                return nil;
+            }
+            Float64 value;
+            memcpy(&value, &value64, sizeof(value));
+            return @(value);
+        }
+        case OWSCompactRecordTypeBool:
+            return (payloadLength == 1) ? @((BOOL)(payload[0] != 0)) : nil;
+    }
+    OWSLogError(@"Unknown compact record type: %d.", bytes[2]);
+    return nil;
+}
+
++ (YapDatabaseSerializer)compactSerializer
+{
+    return ^NSData *(NSString __unused *collection, NSString __unused *key, id object) {
+        if (kCompactRecordWriteVersion >= kCompactRecordVersion) {
+            NSData *_Nullable compactData = OWSCompactRecordDataForObject(object);
+            if (compactData) {
+                return compactData;
+            }
+        }
+        return [NSKeyedArchiver archivedDataWithRootObject:object];
+    };
+}
+
 /**
  * NSCoding sometimes throws exceptions killing our app. We want to log that exception.
  **/
@@ -431,6 +598,11 @@ NSString *const kNSUserDefaults_DatabaseExtensionVersionMap = @"kNSUserDefaults_
             return [OWSUnknownDBObject new];
         }
 
+        if (data.length >= kCompactRecordHeaderLength && ((const uint8_t *)data.bytes)[0] == kCompactRecordMagic) {
+            id _Nullable object = OWSObjectForCompactRecordData(data);
+            return object ?: [OWSUnknownDBObject new];
+        }
+
         @try {
             NSKeyedUnarchiver *unarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:data];
             unarchiver.delegate = unarchiverDelegate;
@@ -799,9 +971,50 @@ NSString *const kNSUserDefaults_DatabaseExtensionVersionMap = @"kNSUserDefaults_
     }
 }
 
-- (void)logFileSizes
+// Returns the number of bytes taken up by pages on SQLite's free list, i.e. the space a VACUUM would reclaim.
+- (unsigned long long)databaseFreePagesSize
 {
+    __block long long pageCount = 0;
+    __block long long pageSize = 0;
+    [OWSPrimaryStorage.dbReadConnection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+        sqlite3 *db = transaction->connection->db;
+        sqlite3_stmt *statement;
+        if (sqlite3_prepare_v2(db, "PRAGMA freelist_count;", -1, &statement, NULL) == SQLITE_OK) {
+            if (sqlite3_step(statement) == SQLITE_ROW) {
+                pageCount = sqlite3_column_int64(statement, 0);
+            }
+            sqlite3_finalize(statement);
+        }
+        if (sqlite3_prepare_v2(db, "PRAGMA page_size;", -1, &statement, NULL) == SQLITE_OK) {
+            if (sqlite3_step(statement) == SQLITE_ROW) {
+                pageSize = sqlite3_column_int64(statement, 0);
+            }
+            sqlite3_finalize(statement);
+        }
+    }];
+    return (unsigned long long)MAX(pageCount * pageSize, 0);
+}
 
+- (void)logFileSizes
+{
+    unsigned long long databaseFileSize = self.databaseFileSize;
+    unsigned long long walFileSize = self.databaseWALFileSize;
+    OWSLogInfo(@"Database file size: %llu, WAL file size: %llu, SHM file size: %llu.",
+        databaseFileSize,
+        walFileSize,
+        self.databaseSHMFileSize);
+    if (SNMetrics.isEnabled) {
+        // Reading the free list takes a read transaction, so only do it when it's recorded.
+        [SNMetrics recordValue:databaseFileSize withName:@"storage.database_file_size"];
+        [SNMetrics recordValue:self.databaseFreePagesSize withName:@"storage.free_pages_size"];
+        [SNMetrics recordValue:walFileSize withName:@"storage.wal_file_size"];
+    }
+    if (walFileSize > kMaxDatabaseWALFileSize) {
+        // A persistently large WAL means that checkpoints aren't able to complete (e.g. because of a long
+        // running read transaction in another process).
+        OWSLogWarn(@"Database WAL file is larger than expected.");
+        [SNMetrics incrementCounterWithName:@"storage.wal_file_size_exceeded"];
+    }
 }
 
 @end
@@ -5,6 +5,9 @@ extension Storage {
         return "SNClosedGroupEncryptionKeyPairCollection-\(groupPublicKey)"
     }
 
+    /// A mapping from group public key to the group's latest encryption key pair, maintained alongside the group's
+    /// encryption key pair collection.
+    private static let closedGroupLatestEncryptionKeyPairCollection = "SNClosedGroupLatestEncryptionKeyPairCollection"
     private static let closedGroupPublicKeyCollection = "SNClosedGroupPublicKeyCollection"
     private static let closedGroupFormationTimestampCollection = "SNClosedGroupFormationTimestampCollection"
     private static let closedGroupZombieMembersCollection = "SNClosedGroupZombieMembersCollection"
@@ -22,18 +25,44 @@ extension Storage {
     }
 
     public func getLatestClosedGroupEncryptionKeyPair(for groupPublicKey: String) -> ECKeyPair? {
-        return getClosedGroupEncryptionKeyPairs(for: groupPublicKey).last
+        var result: ECKeyPair?
+        Storage.read { transaction in
+            result = transaction.object(forKey: groupPublicKey, inCollection: Storage.closedGroupLatestEncryptionKeyPairCollection) as? ECKeyPair
+        }
+        if let result = result { return result }
+        // Groups whose latest key pair was added before the index was introduced aren't in it yet
+        guard let keyPair = getClosedGroupEncryptionKeyPairs(for: groupPublicKey).last else { return nil }
+        let collection = Storage.getClosedGroupEncryptionKeyPairCollection(for: groupPublicKey)
+        Storage.write { transaction in
+            // Don't overwrite a key pair that was added in the meantime
+            guard transaction.object(forKey: groupPublicKey, inCollection: Storage.closedGroupLatestEncryptionKeyPairCollection) == nil else { return }
+            // Only index the key pair if it's still the latest one (e.g. the group's key pairs might have been removed since)
+            var latestTimestamp: Double?
+            var isLatest = false
+            transaction.enumerateKeysAndObjects(inCollection: collection) { key, object, _ in
+                guard let timestamp = Double(key), let candidate = object as? ECKeyPair, timestamp >= (latestTimestamp ?? timestamp) else { return }
+                latestTimestamp = timestamp
+                isLatest = (candidate.publicKey == keyPair.publicKey)
+            }
+            guard isLatest else { return }
+            transaction.setObject(keyPair, forKey: groupPublicKey, inCollection: Storage.closedGroupLatestEncryptionKeyPairCollection)
+        }
+        return keyPair
     }
 
     public func addClosedGroupEncryptionKeyPair(_ keyPair: ECKeyPair, for groupPublicKey: String, using transaction: Any) {
         let collection = Storage.getClosedGroupEncryptionKeyPairCollection(for: groupPublicKey)
         let timestamp = String(Date().timeIntervalSince1970)
-        (transaction as! YapDatabaseReadWriteTransaction).setObject(keyPair, forKey: timestamp, inCollection: collection)
+        let transaction = transaction as! YapDatabaseReadWriteTransaction
+        transaction.setObject(keyPair, forKey: timestamp, inCollection: collection)
+        transaction.setObject(keyPair, forKey: groupPublicKey, inCollection: Storage.closedGroupLatestEncryptionKeyPairCollection)
     }
 
     public func removeAllClosedGroupEncryptionKeyPairs(for groupPublicKey: String, using transaction: Any) {
         let collection = Storage.getClosedGroupEncryptionKeyPairCollection(for: groupPublicKey)
-        (transaction as! YapDatabaseReadWriteTransaction).removeAllObjects(inCollection: collection)
+        let transaction = transaction as! YapDatabaseReadWriteTransaction
+        transaction.removeAllObjects(inCollection: collection)
+        transaction.removeObject(forKey: groupPublicKey, inCollection: Storage.closedGroupLatestEncryptionKeyPairCollection)
     }
     
     public func getUserClosedGroupPublicKeys() -> Set<String> {
@@ -7,13 +7,43 @@ extension Storage {
     public func getContact(with sessionID: String) -> Contact? {
         var result: Contact?
         Storage.read { transaction in
-            result = transaction.object(forKey: sessionID, inCollection: Storage.contactCollection) as? Contact
+            result = self.getContact(with: sessionID, using: transaction)
         }
-        if let result = result, result.sessionID == getUserHexEncodedPublicKey() {
+        return result
+    }
+
+    /// Like `getContact(with:)`, but using the given transaction. Use this when looking up many contacts at once.
+    public func getContact(with sessionID: String, using transaction: Any) -> Contact? {
+        let transaction = transaction as! YapDatabaseReadTransaction
+        let result = transaction.object(forKey: sessionID, inCollection: Storage.contactCollection) as? Contact
+        if let result = result, result.sessionID == getUserPublicKey(using: transaction) {
             result.isTrusted = true // Always trust ourselves
         }
         return result
     }
+
+    /// Looks up the contacts for the given session IDs in a single read transaction. Session IDs without a contact are
+    /// left out of the result.
+    public func getContacts(with sessionIDs: Set<String>) -> [String:Contact] {
+        var result: [String:Contact] = [:]
+        Storage.read { transaction in
+            let userPublicKey = self.getUserPublicKey(using: transaction)
+            for sessionID in sessionIDs {
+                guard let contact = transaction.object(forKey: sessionID, inCollection: Storage.contactCollection) as? Contact else { continue }
+                if contact.sessionID == userPublicKey {
+                    contact.isTrusted = true // Always trust ourselves
+                }
+                result[sessionID] = contact
+            }
+        }
+        return result
+    }
+
+    /// `getUserHexEncodedPublicKey()` opens a read transaction of its own, which adds up when looking up contacts in a loop.
+    private func getUserPublicKey(using transaction: YapDatabaseReadTransaction) -> String? {
+        let keyPair = transaction.keyPair(forKey: OWSPrimaryStorageIdentityKeyStoreIdentityKey, inCollection: OWSPrimaryStorageIdentityKeyStoreCollection)
+        return keyPair?.hexEncodedPublicKey
+    }
     
     @objc(setContact:usingTransaction:)
     public func setContact(_ contact: Contact, using transaction: Any) {
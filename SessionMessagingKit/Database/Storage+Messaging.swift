@@ -78,6 +78,21 @@ extension Storage {
         MessageInvalidator.invalidate(tsMessage, with: transaction)
     }
 
+    // Stored in the database rather than in the user defaults so that it's cleared along with the rest of the user's data.
+    private static let lastConfigurationSyncHashCollection = "LastConfigurationSyncHashCollection"
+
+    public func getLastConfigurationSyncHash() -> String? {
+        var result: String?
+        Storage.read { transaction in
+            result = transaction.object(forKey: "lastConfigurationSyncHash", inCollection: Storage.lastConfigurationSyncHashCollection) as? String
+        }
+        return result
+    }
+
+    public func setLastConfigurationSyncHash(to newValue: String, using transaction: Any) {
+        (transaction as! YapDatabaseReadWriteTransaction).setObject(newValue, forKey: "lastConfigurationSyncHash", inCollection: Storage.lastConfigurationSyncHashCollection)
+    }
+
     private static let receivedMessageTimestampsCollection = "ReceivedMessageTimestampsCollection"
 
     public func getReceivedMessageTimestamps(using transaction: Any) -> [UInt64] {
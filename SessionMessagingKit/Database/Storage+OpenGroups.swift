@@ -4,6 +4,8 @@ extension Storage {
     // MARK: - Open Groups
     
     private static let openGroupCollection = "SNOpenGroupCollection"
+    /// A mapping from open group ID to thread ID, maintained alongside `openGroupCollection`.
+    private static let openGroupThreadIDCollection = "SNOpenGroupThreadIDCollection"
     
     @objc public func getAllV2OpenGroups() -> [String:OpenGroupV2] {
         var result = [String:OpenGroupV2]()
@@ -27,24 +29,46 @@ extension Storage {
     
     public func v2GetThreadID(for v2OpenGroupID: String) -> String? {
         var result: String?
+        var isIndexed = false
         Storage.read { transaction in
+            if let threadID = transaction.object(forKey: v2OpenGroupID, inCollection: Storage.openGroupThreadIDCollection) as? String {
+                result = threadID
+                isIndexed = true
+                return
+            }
+            // Open groups joined before the index was introduced aren't in it yet
             transaction.enumerateKeysAndObjects(inCollection: Storage.openGroupCollection, using: { threadID, object, stop in
                 guard let openGroup = object as? OpenGroupV2, openGroup.id == v2OpenGroupID else { return }
                 result = threadID
                 stop.pointee = true
             })
         }
+        if let threadID = result, !isIndexed {
+            Storage.write { transaction in
+                // The open group might have been removed (or the index entry set) since it was read above
+                guard transaction.object(forKey: v2OpenGroupID, inCollection: Storage.openGroupThreadIDCollection) == nil,
+                    let openGroup = transaction.object(forKey: threadID, inCollection: Storage.openGroupCollection) as? OpenGroupV2,
+                    openGroup.id == v2OpenGroupID else { return }
+                transaction.setObject(threadID, forKey: v2OpenGroupID, inCollection: Storage.openGroupThreadIDCollection)
+            }
+        }
         return result
     }
 
     @objc(setV2OpenGroup:forThreadWithID:using:)
     public func setV2OpenGroup(_ openGroup: OpenGroupV2, for threadID: String, using transaction: Any) {
-        (transaction as! YapDatabaseReadWriteTransaction).setObject(openGroup, forKey: threadID, inCollection: Storage.openGroupCollection)
+        let transaction = transaction as! YapDatabaseReadWriteTransaction
+        transaction.setObject(openGroup, forKey: threadID, inCollection: Storage.openGroupCollection)
+        transaction.setObject(threadID, forKey: openGroup.id, inCollection: Storage.openGroupThreadIDCollection)
     }
 
     @objc(removeV2OpenGroupForThreadID:using:)
     public func removeV2OpenGroup(for threadID: String, using transaction: Any) {
-        (transaction as! YapDatabaseReadWriteTransaction).removeObject(forKey: threadID, inCollection: Storage.openGroupCollection)
+        let transaction = transaction as! YapDatabaseReadWriteTransaction
+        if let openGroup = transaction.object(forKey: threadID, inCollection: Storage.openGroupCollection) as? OpenGroupV2 {
+            transaction.removeObject(forKey: openGroup.id, inCollection: Storage.openGroupThreadIDCollection)
+        }
+        transaction.removeObject(forKey: threadID, inCollection: Storage.openGroupCollection)
     }
     
     
@@ -52,6 +76,7 @@ extension Storage {
     // MARK: - Authorization
 
     private static let authTokenCollection = "SNAuthTokenCollection"
+    private static let authTokenDateCollection = "SNAuthTokenDateCollection"
 
     public func getAuthToken(for room: String, on server: String) -> String? {
         let collection = Storage.authTokenCollection
@@ -66,13 +91,29 @@ extension Storage {
     public func setAuthToken(for room: String, on server: String, to newValue: String, using transaction: Any) {
         let collection = Storage.authTokenCollection
         let key = "\(server).\(room)"
-        (transaction as! YapDatabaseReadWriteTransaction).setObject(newValue, forKey: key, inCollection: collection)
+        let transaction = transaction as! YapDatabaseReadWriteTransaction
+        transaction.setObject(newValue, forKey: key, inCollection: collection)
+        transaction.setObject(Date(), forKey: key, inCollection: Storage.authTokenDateCollection)
     }
 
     public func removeAuthToken(for room: String, on server: String, using transaction: Any) {
         let collection = Storage.authTokenCollection
         let key = "\(server).\(room)"
-        (transaction as! YapDatabaseReadWriteTransaction).removeObject(forKey: key, inCollection: collection)
+        let transaction = transaction as! YapDatabaseReadWriteTransaction
+        transaction.removeObject(forKey: key, inCollection: collection)
+        transaction.removeObject(forKey: key, inCollection: Storage.authTokenDateCollection)
+    }
+
+    /// Returns the date at which the auth token for the given room was stored, if known. Tokens stored before
+    /// this was tracked don't have a date.
+    public func getAuthTokenDate(for room: String, on server: String) -> Date? {
+        let collection = Storage.authTokenDateCollection
+        let key = "\(server).\(room)"
+        var result: Date? = nil
+        Storage.read { transaction in
+            result = transaction.object(forKey: key, inCollection: collection) as? Date
+        }
+        return result
     }
 
 
@@ -17,6 +17,10 @@ public final class FileServerAPIV2 : NSObject {
     /// uploading a file we just divide the size of the file by this number. The alternative would be to actually check the size of the HTTP request but that's only
     /// possible after proof of work has been calculated and the onion request encryption has happened, which takes several seconds.
     public static let fileSizeORMultiplier: Double = 2
+    /// The number of times a file transfer is retried over a different path before the error is reported to the caller. Path failures
+    /// are common on slow links, and retrying here means the job layer doesn't have to re-read, re-encrypt and re-encode the whole file.
+    /// Uploads that timed out aren't retried, as the file server might have stored the file already.
+    public static let maxTransferRetryCount: UInt = 2
     
     // MARK: Initialization
     private override init() { }
@@ -59,7 +63,7 @@ public final class FileServerAPIV2 : NSObject {
     }
     
     // MARK: Convenience
-    private static func send(_ request: Request, useOldServer: Bool) -> Promise<JSON> {
+    private static func send(_ request: Request, useOldServer: Bool, maxRetryCount: UInt = 0) -> Promise<JSON> {
         let server = useOldServer ? oldServer : server
         let serverPublicKey = useOldServer ? oldServerPublicKey : serverPublicKey
         let tsRequest: TSRequest
@@ -79,12 +83,12 @@ public final class FileServerAPIV2 : NSObject {
         }
         tsRequest.allHTTPHeaderFields = request.headers
         if request.useOnionRouting {
-            return OnionRequestAPI.sendOnionRequest(tsRequest, to: server, using: serverPublicKey)
+            return OnionRequestAPI.sendOnionRequest(tsRequest, to: server, using: serverPublicKey, maxRetryCount: maxRetryCount, isIdempotent: request.verb == .get)
         } else {
             preconditionFailure("It's currently not allowed to send non onion routed requests.")
         }
     }
-    
+
     // MARK: File Storage
     @objc(upload:)
     public static func objc_upload(file: Data) -> AnyPromise {
@@ -95,7 +99,7 @@ public final class FileServerAPIV2 : NSObject {
         let base64EncodedFile = file.base64EncodedString()
         let parameters = [ "file" : base64EncodedFile ]
         let request = Request(verb: .post, endpoint: "files", parameters: parameters)
-        return send(request, useOldServer: false).map(on: DispatchQueue.global(qos: .userInitiated)) { json in
+        return send(request, useOldServer: false, maxRetryCount: maxTransferRetryCount).map(on: DispatchQueue.global(qos: .userInitiated)) { json in
             guard let fileID = json["result"] as? UInt64 else { throw Error.parsingFailed }
             return fileID
         }
@@ -109,7 +113,7 @@ public final class FileServerAPIV2 : NSObject {
     
     public static func download(_ file: UInt64, useOldServer: Bool) -> Promise<Data> {
         let request = Request(verb: .get, endpoint: "files/\(file)")
-        return send(request, useOldServer: useOldServer).map(on: DispatchQueue.global(qos: .userInitiated)) { json in
+        return send(request, useOldServer: useOldServer, maxRetryCount: maxTransferRetryCount).map(on: DispatchQueue.global(qos: .userInitiated)) { json in
             guard let base64EncodedFile = json["result"] as? String, let file = Data(base64Encoded: base64EncodedFile) else { throw Error.parsingFailed }
             return file
         }
@@ -6,14 +6,22 @@ public final class JobQueue : NSObject, JobDelegate {
     private static var jobIDs: [UInt64:UInt64] = [:]
 
     internal static var currentlyExecutingJobs: Set<String> = []
+
+    /// Job ID to the span measuring its execution.
+    ///
+    /// - Note: Should only be accessed while holding `executionSpansLock`, as jobs report back from various queues.
+    private static var executionSpans: [String:Metrics.Span] = [:]
+    private static let executionSpansLock = NSLock()
     
     @objc public static let shared = JobQueue()
 
     @objc public func add(_ job: Job, using transaction: Any) {
         let transaction = transaction as! YapDatabaseReadWriteTransaction
         addWithoutExecuting(job, using: transaction)
+        let queueWaitSpan = Metrics.beginSpan("job.\(type(of: job)).queue_wait")
         transaction.addCompletionQueue(Threading.jobQueue) {
-            job.execute()
+            queueWaitSpan?.end()
+            self.execute(job)
         }
     }
 
@@ -41,13 +49,31 @@ public final class JobQueue : NSObject, JobDelegate {
                 }
                 SNLog("Resuming pending job of type: \(type).")
                 job.delegate = self
-                job.execute()
+                self.execute(job)
             }
         }
     }
 
+    private func execute(_ job: Job) {
+        if let id = job.id, let span = Metrics.beginSpan("job.\(type(of: job)).execution") {
+            JobQueue.executionSpansLock.lock()
+            JobQueue.executionSpans[id] = span
+            JobQueue.executionSpansLock.unlock()
+        }
+        job.execute()
+    }
+
+    private func endExecutionSpan(for job: Job) {
+        guard let id = job.id else { return }
+        JobQueue.executionSpansLock.lock()
+        let span = JobQueue.executionSpans.removeValue(forKey: id)
+        JobQueue.executionSpansLock.unlock()
+        span?.end()
+    }
+
     public func handleJobSucceeded(_ job: Job) {
         given(job.id) { JobQueue.currentlyExecutingJobs.remove($0) }
+        endExecutionSpan(for: job)
         SNMessagingKitConfiguration.shared.storage.write(with: { transaction in
             SNMessagingKitConfiguration.shared.storage.markJobAsSucceeded(job, using: transaction)
         }, completion: {
@@ -57,6 +83,8 @@ public final class JobQueue : NSObject, JobDelegate {
 
     public func handleJobFailed(_ job: Job, with error: Error) {
         given(job.id) { JobQueue.currentlyExecutingJobs.remove($0) }
+        endExecutionSpan(for: job)
+        Metrics.increment("job.\(type(of: job)).failures")
         job.failureCount += 1
         let storage = SNMessagingKitConfiguration.shared.storage
         guard !storage.isJobCanceled(job) else { return SNLog("\(type(of: job)) canceled.") }
@@ -79,6 +107,8 @@ public final class JobQueue : NSObject, JobDelegate {
 
     public func handleJobFailedPermanently(_ job: Job, with error: Error) {
         given(job.id) { JobQueue.currentlyExecutingJobs.remove($0) }
+        endExecutionSpan(for: job)
+        Metrics.increment("job.\(type(of: job)).failures")
         job.failureCount += 1
         let storage = SNMessagingKitConfiguration.shared.storage
         storage.write(with: { transaction in
@@ -108,6 +138,6 @@ public final class JobQueue : NSObject, JobDelegate {
         guard let job = timer.userInfo as? Job else { return }
         SNLog("Retrying \(type(of: job)).")
         job.delegate = self
-        job.execute()
+        execute(job)
     }
 }
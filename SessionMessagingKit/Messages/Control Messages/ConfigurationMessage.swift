@@ -1,3 +1,4 @@
+import CryptoSwift
 import SessionUtilitiesKit
 
 @objc(SNConfigurationMessage)
@@ -76,6 +77,29 @@ public final class ConfigurationMessage : ControlMessage {
         }
     }
 
+    // MARK: Content Hash
+    /// A hash of the message's content that doesn't depend on the (unspecified) iteration order of its sets. Used to avoid
+    /// sending a configuration message that's identical to the last one that was sent.
+    public var contentHash: String {
+        var components: [String] = [ displayName ?? "", profilePictureURL ?? "", profileKey?.toHexString() ?? "" ]
+        closedGroups.sorted { $0.publicKey < $1.publicKey }.forEach { closedGroup in
+            components.append(closedGroup.publicKey)
+            components.append(closedGroup.name)
+            components.append(closedGroup.encryptionKeyPair.hexEncodedPublicKey)
+            components.append(closedGroup.members.sorted().joined(separator: ","))
+            components.append(closedGroup.admins.sorted().joined(separator: ","))
+            components.append(String(closedGroup.expirationTimer))
+        }
+        components.append(contentsOf: openGroups.sorted())
+        contacts.sorted { ($0.publicKey ?? "") < ($1.publicKey ?? "") }.forEach { contact in
+            components.append(contact.publicKey ?? "")
+            components.append(contact.displayName ?? "")
+            components.append(contact.profilePictureURL ?? "")
+            components.append(contact.profileKey?.toHexString() ?? "")
+        }
+        return components.joined(separator: "\n").sha256()
+    }
+
     // MARK: Description
     public override var description: String {
         """
@@ -3,7 +3,6 @@ import SessionSnodeKit
 
 @objc(SNOpenGroupAPIV2)
 public final class OpenGroupAPIV2 : NSObject {
-    private static var authTokenPromises: [String:Promise<String>] = [:]
     private static var hasPerformedInitialPoll: [String:Bool] = [:]
     private static var hasUpdatedLastOpenDate = false
     public static let workQueue = DispatchQueue(label: "OpenGroupAPIV2.workQueue", qos: .userInitiated) // It's important that this is a serial queue
@@ -89,6 +88,8 @@ public final class OpenGroupAPIV2 : NSObject {
         let messages: [OpenGroupMessageV2]
         let deletions: [Deletion]
         let moderators: [String]
+
+        var isEmpty: Bool { return messages.isEmpty && deletions.isEmpty }
     }
     
     public struct Deletion {
@@ -123,7 +124,7 @@ public final class OpenGroupAPIV2 : NSObject {
         if request.useOnionRouting {
             guard let publicKey = SNMessagingKitConfiguration.shared.storage.getOpenGroupPublicKey(for: request.server) else { return Promise(error: Error.noPublicKey) }
             if request.isAuthRequired, let room = request.room { // Because auth happens on a per-room basis, we need both to make an authenticated request
-                return getAuthToken(for: room, on: request.server).then(on: OpenGroupAPIV2.workQueue) { authToken -> Promise<JSON> in
+                return OpenGroupAuthTokenManagerV2.shared.getAuthToken(for: room, on: request.server).then(on: OpenGroupAPIV2.workQueue) { authToken -> Promise<JSON> in
                     tsRequest.setValue(authToken, forHTTPHeaderField: "Authorization")
                     let promise = OnionRequestAPI.sendOnionRequest(tsRequest, to: request.server, using: publicKey)
                     promise.catch(on: OpenGroupAPIV2.workQueue) { error in
@@ -131,9 +132,8 @@ public final class OpenGroupAPIV2 : NSObject {
                         // indication that the token we're using has expired. Note that a 403 has a different meaning; it means that
                         // we provided a valid token but it doesn't have a high enough permission level for the route in question.
                         if case OnionRequestAPI.Error.httpRequestFailedAtDestination(let statusCode, _, _) = error, statusCode == 401 {
-                            let storage = SNMessagingKitConfiguration.shared.storage
-                            storage.writeSync { transaction in
-                                storage.removeAuthToken(for: room, on: request.server, using: transaction)
+                            SNMessagingKitConfiguration.shared.storage.writeSync { transaction in
+                                OpenGroupAuthTokenManagerV2.shared.invalidateAuthToken(for: room, on: request.server, using: transaction)
                             }
                         }
                     }
@@ -147,20 +147,22 @@ public final class OpenGroupAPIV2 : NSObject {
         }
     }
     
-    public static func compactPoll(_ server: String) -> Promise<[CompactPollResponseBody]> {
+    /// Polls all joined rooms on `server` except for the ones in `excludedRooms`.
+    public static func compactPoll(_ server: String, excluding excludedRooms: Set<String> = []) -> Promise<[CompactPollResponseBody]> {
         let storage = SNMessagingKitConfiguration.shared.storage
-        let rooms = storage.getAllV2OpenGroups().values.filter { $0.server == server }.map { $0.room }
+        let rooms = storage.getAllV2OpenGroups().values.filter { $0.server == server && !excludedRooms.contains($0.room) }.map { $0.room }
         var body: [JSON] = []
-        var authTokenPromises: [String:Promise<String>] = [:]
-        let useMessageLimit = (hasPerformedInitialPoll[server] != true && timeSinceLastOpen > OpenGroupPollerV2.maxInactivityPeriod)
-        hasPerformedInitialPoll[server] = true
         if !hasUpdatedLastOpenDate {
             UserDefaults.standard[.lastOpen] = Date()
             hasUpdatedLastOpenDate = true
         }
         for room in rooms {
-            authTokenPromises[room] = getAuthToken(for: room, on: server)
-            var json: JSON = [ "room_id" : room ]
+            // Rooms without a valid auth token are left out of this poll rather than holding up the other rooms. The
+            // token manager refreshes their tokens in the background so that they can be included in a later poll.
+            guard let authToken = OpenGroupAuthTokenManagerV2.shared.getValidAuthToken(for: room, on: server) else { continue }
+            let useMessageLimit = (hasPerformedInitialPoll["\(server).\(room)"] != true && timeSinceLastOpen > OpenGroupPollerV2.maxInactivityPeriod)
+            hasPerformedInitialPoll["\(server).\(room)"] = true
+            var json: JSON = [ "room_id" : room, "auth_token" : authToken ]
             if let lastMessageServerID = storage.getLastMessageServerID(for: room, on: server) {
                 json["from_message_server_id"] = useMessageLimit ? nil : lastMessageServerID
             }
@@ -169,71 +171,34 @@ public final class OpenGroupAPIV2 : NSObject {
             }
             body.append(json)
         }
-        return when(fulfilled: [Promise<String>](authTokenPromises.values)).then(on: OpenGroupAPIV2.workQueue) { _ -> Promise<[CompactPollResponseBody]> in
-            let bodyWithAuthTokens = body.compactMap { json -> JSON? in
-                guard let roomID = json["room_id"] as? String, let authToken = authTokenPromises[roomID]?.value else { return nil }
-                var json = json
-                json["auth_token"] = authToken
-                return json
-            }
-            let request = Request(verb: .post, room: nil, server: server, endpoint: "compact_poll", parameters: [ "requests" : bodyWithAuthTokens ], isAuthRequired: false)
-            return send(request).then(on: OpenGroupAPIV2.workQueue) { json -> Promise<[CompactPollResponseBody]> in
-                guard let results = json["results"] as? [JSON] else { throw Error.parsingFailed }
-                let promises = results.compactMap { json -> Promise<CompactPollResponseBody>? in
-                    guard let room = json["room_id"] as? String, let status = json["status_code"] as? UInt else { return nil }
-                    // A 401 means that we didn't provide a (valid) auth token for a route that required one. We use this as an
-                    // indication that the token we're using has expired. Note that a 403 has a different meaning; it means that
-                    // we provided a valid token but it doesn't have a high enough permission level for the route in question.
-                    guard status != 401 else {
-                        storage.writeSync { transaction in
-                            storage.removeAuthToken(for: room, on: server, using: transaction)
-                        }
-                        return nil
+        guard !body.isEmpty else { return Promise.value([]) }
+        let request = Request(verb: .post, room: nil, server: server, endpoint: "compact_poll", parameters: [ "requests" : body ], isAuthRequired: false)
+        return send(request).then(on: OpenGroupAPIV2.workQueue) { json -> Promise<[CompactPollResponseBody]> in
+            guard let results = json["results"] as? [JSON] else { throw Error.parsingFailed }
+            let promises = results.compactMap { json -> Promise<CompactPollResponseBody>? in
+                guard let room = json["room_id"] as? String, let status = json["status_code"] as? UInt else { return nil }
+                // A 401 means that we didn't provide a (valid) auth token for a route that required one. We use this as an
+                // indication that the token we're using has expired. Note that a 403 has a different meaning; it means that
+                // we provided a valid token but it doesn't have a high enough permission level for the route in question.
+                guard status != 401 else {
+                    storage.writeSync { transaction in
+                        OpenGroupAuthTokenManagerV2.shared.invalidateAuthToken(for: room, on: server, using: transaction)
                     }
-                    let rawDeletions = json["deletions"] as? [JSON] ?? []
-                    let moderators = json["moderators"] as? [String] ?? []
-                    return try? parseMessages(from: json, for: room, on: server).then(on: OpenGroupAPIV2.workQueue) { messages in
-                        parseDeletions(from: rawDeletions, for: room, on: server).map(on: OpenGroupAPIV2.workQueue) { deletions in
-                            return CompactPollResponseBody(room: room, messages: messages, deletions: deletions, moderators: moderators)
-                        }
+                    return nil
+                }
+                let rawDeletions = json["deletions"] as? [JSON] ?? []
+                let moderators = json["moderators"] as? [String] ?? []
+                return try? parseMessages(from: json, for: room, on: server).then(on: OpenGroupAPIV2.workQueue) { messages in
+                    parseDeletions(from: rawDeletions, for: room, on: server).map(on: OpenGroupAPIV2.workQueue) { deletions in
+                        return CompactPollResponseBody(room: room, messages: messages, deletions: deletions, moderators: moderators)
                     }
                 }
-                return when(fulfilled: promises)
             }
+            return when(fulfilled: promises)
         }
     }
     
     // MARK: Authorization
-    private static func getAuthToken(for room: String, on server: String) -> Promise<String> {
-        let storage = SNMessagingKitConfiguration.shared.storage
-        if let authToken = storage.getAuthToken(for: room, on: server) {
-            return Promise.value(authToken)
-        } else {
-            if let authTokenPromise = authTokenPromises["\(server).\(room)"] {
-                return authTokenPromise
-            } else {
-                let promise = requestNewAuthToken(for: room, on: server)
-                .then(on: OpenGroupAPIV2.workQueue) { claimAuthToken($0, for: room, on: server) }
-                .then(on: OpenGroupAPIV2.workQueue) { authToken -> Promise<String> in
-                    let (promise, seal) = Promise<String>.pending()
-                    storage.write(with: { transaction in
-                        storage.setAuthToken(for: room, on: server, to: authToken, using: transaction)
-                    }, completion: {
-                        seal.fulfill(authToken)
-                    })
-                    return promise
-                }
-                promise.done(on: OpenGroupAPIV2.workQueue) { _ in
-                    authTokenPromises["\(server).\(room)"] = nil
-                }.catch(on: OpenGroupAPIV2.workQueue) { _ in
-                    authTokenPromises["\(server).\(room)"] = nil
-                }
-                authTokenPromises["\(server).\(room)"] = promise
-                return promise
-            }
-        }
-    }
-
     public static func requestNewAuthToken(for room: String, on server: String) -> Promise<String> {
         SNLog("Requesting auth token for server: \(server).")
         guard let userKeyPair = SNMessagingKitConfiguration.shared.storage.getUserKeyPair() else { return Promise(error: Error.generic) }
@@ -0,0 +1,109 @@
+import PromiseKit
+
+/// Keeps track of the age of open group auth tokens and refreshes them in the background before they're likely to
+/// expire. This means that polling never has to wait on an auth token round trip; rooms that don't have a valid token
+/// yet are left out of the poll until their refresh completes.
+public final class OpenGroupAuthTokenManagerV2 {
+    private let queue = DispatchQueue(label: "OpenGroupAuthTokenManagerV2.queue") // It's important that this is a serial queue
+    private var authTokenPromises: [String:Promise<String>] = [:]
+    private var scheduledRefreshes: [(room: String, server: String)] = []
+    private var activeRefreshCount = 0
+    private var lastFailureDates: [String:Date] = [:]
+
+    // MARK: Settings
+    /// The server doesn't tell us when a token expires, so we assume a conservative lifetime. A 401 is still treated
+    /// as an indication that a token expired early.
+    public static let maxAuthTokenAge: TimeInterval = 7 * 24 * 60 * 60
+    /// How long before `maxAuthTokenAge` is reached a token starts being refreshed in the background.
+    public static let refreshMargin: TimeInterval = 24 * 60 * 60
+    public static let maxConcurrentRefreshCount = 4
+    /// The minimum amount of time between background refreshes of a token after a failed attempt.
+    public static let retryInterval: TimeInterval = 30
+
+    // MARK: Initialization
+    public static let shared = OpenGroupAuthTokenManagerV2()
+
+    private init() { }
+
+    // MARK: Auth Tokens
+    /// Returns the auth token for the given room, requesting a new one if needed. Concurrent calls for the same
+    /// room share a single request.
+    public func getAuthToken(for room: String, on server: String) -> Promise<String> {
+        if let authToken = getValidAuthToken(for: room, on: server) { return Promise.value(authToken) }
+        return queue.sync { requestAuthToken(for: room, on: server) }
+    }
+
+    /// Returns the auth token for the given room if a valid one is available, without waiting on the network. If the
+    /// token is missing or about to expire a refresh is scheduled in the background.
+    public func getValidAuthToken(for room: String, on server: String) -> String? {
+        let storage = SNMessagingKitConfiguration.shared.storage
+        guard let authToken = storage.getAuthToken(for: room, on: server) else {
+            scheduleRefresh(for: room, on: server)
+            return nil
+        }
+        let age = given(storage.getAuthTokenDate(for: room, on: server)) { Date().timeIntervalSince($0) } ?? 0
+        if age >= OpenGroupAuthTokenManagerV2.maxAuthTokenAge - OpenGroupAuthTokenManagerV2.refreshMargin {
+            scheduleRefresh(for: room, on: server)
+        }
+        return (age < OpenGroupAuthTokenManagerV2.maxAuthTokenAge) ? authToken : nil
+    }
+
+    /// Should be called when the server indicates that the auth token for the given room is no longer valid.
+    public func invalidateAuthToken(for room: String, on server: String, using transaction: Any) {
+        SNMessagingKitConfiguration.shared.storage.removeAuthToken(for: room, on: server, using: transaction)
+    }
+
+    // MARK: Refreshing
+    private func scheduleRefresh(for room: String, on server: String) {
+        queue.async {
+            let key = "\(server).\(room)"
+            guard self.authTokenPromises[key] == nil,
+                !self.scheduledRefreshes.contains(where: { $0.room == room && $0.server == server }) else { return }
+            if let lastFailureDate = self.lastFailureDates[key],
+                Date().timeIntervalSince(lastFailureDate) < OpenGroupAuthTokenManagerV2.retryInterval { return }
+            self.scheduledRefreshes.append((room: room, server: server))
+            self.startScheduledRefreshesIfNeeded()
+        }
+    }
+
+    /// Must be called on `queue`.
+    private func startScheduledRefreshesIfNeeded() {
+        while activeRefreshCount < OpenGroupAuthTokenManagerV2.maxConcurrentRefreshCount && !scheduledRefreshes.isEmpty {
+            let (room, server) = scheduledRefreshes.removeFirst()
+            activeRefreshCount += 1
+            requestAuthToken(for: room, on: server).ensure(on: queue) {
+                self.activeRefreshCount -= 1
+                self.startScheduledRefreshesIfNeeded()
+            }.catch(on: queue) { error in
+                SNLog("Couldn't refresh auth token for server: \(server) due to error: \(error).")
+            }
+        }
+    }
+
+    /// Must be called on `queue`.
+    private func requestAuthToken(for room: String, on server: String) -> Promise<String> {
+        let key = "\(server).\(room)"
+        if let authTokenPromise = authTokenPromises[key] { return authTokenPromise }
+        let storage = SNMessagingKitConfiguration.shared.storage
+        let promise = OpenGroupAPIV2.requestNewAuthToken(for: room, on: server)
+        .then(on: OpenGroupAPIV2.workQueue) { OpenGroupAPIV2.claimAuthToken($0, for: room, on: server) }
+        .then(on: OpenGroupAPIV2.workQueue) { authToken -> Promise<String> in
+            let (promise, seal) = Promise<String>.pending()
+            storage.write(with: { transaction in
+                storage.setAuthToken(for: room, on: server, to: authToken, using: transaction)
+            }, completion: {
+                seal.fulfill(authToken)
+            })
+            return promise
+        }
+        promise.done(on: queue) { _ in
+            self.authTokenPromises[key] = nil
+            self.lastFailureDates[key] = nil
+        }.catch(on: queue) { _ in
+            self.authTokenPromises[key] = nil
+            self.lastFailureDates[key] = Date()
+        }
+        authTokenPromises[key] = promise
+        return promise
+    }
+}
@@ -7,6 +7,8 @@ import MobileCoreServices
 
 import PromiseKit
 import AVFoundation
+import ImageIO
+import SessionUtilitiesKit
 
 public enum SignalAttachmentError: Error {
     case missingData
@@ -639,7 +641,7 @@ public class SignalAttachment: NSObject {
             if isValidOutput {
                 return removeImageMetadata(attachment: attachment)
             } else {
-                return compressImageAsJPEG(image: image, attachment: attachment, filename: dataSource.sourceFilename, imageQuality: imageQuality)
+                return compressImageAsJPEG(image: image, attachment: attachment, filename: dataSource.sourceFilename, imageQuality: imageQuality, sourceDataSource: dataSource)
             }
         }
     }
@@ -688,7 +690,9 @@ public class SignalAttachment: NSObject {
         return compressImageAsJPEG(image: image, attachment: attachment, filename: filename, imageQuality: imageQuality)
     }
 
-    private class func compressImageAsJPEG(image: UIImage, attachment: SignalAttachment, filename: String?, imageQuality: TSImageQuality) -> SignalAttachment {
+    // If the image's source data is available it's decoded with ImageIO, which
+    // lets large photos be downsampled without decoding them at full size.
+    private class func compressImageAsJPEG(image: UIImage, attachment: SignalAttachment, filename: String?, imageQuality: TSImageQuality, sourceDataSource: DataSource? = nil) -> SignalAttachment {
         assert(attachment.error == nil)
 
         if imageQuality == .original &&
@@ -698,19 +702,21 @@ public class SignalAttachment: NSObject {
             return attachment
         }
 
-        var imageUploadQuality = imageQuality.imageQualityTier()
+        let imageSource = sourceDataSource.flatMap { self.imageSource(for: $0) }
+        var imageUploadQuality = plannedImageQualityTier(image: image, imageSource: imageSource, imageQuality: imageQuality)
 
         while true {
             let maxSize = maxSizeForImage(image: image, imageUploadQuality: imageUploadQuality)
             var dstImage: UIImage! = image
             if image.size.width > maxSize ||
                 image.size.height > maxSize {
-                guard let resizedImage = imageScaled(image, toMaxSize: maxSize) else {
+                guard let resizedImage = imageDownsampled(image, imageSource: imageSource, toMaxSize: maxSize) else {
                     attachment.error = .couldNotResizeImage
                     return attachment
                 }
                 dstImage = resizedImage
             }
+            Metrics.increment("signal_attachment.jpeg_encodes")
             guard let jpgImageData = dstImage.jpegData(compressionQuality: jpegCompressionQuality(imageUploadQuality: imageUploadQuality)) else {
                                                                 attachment.error = .couldNotConvertToJpeg
                                                                 return attachment
@@ -732,27 +738,107 @@ public class SignalAttachment: NSObject {
                 return recompressedAttachment
             }
 
-            // If the JPEG output is larger than the file size limit,
-            // continue to try again by progressively reducing the
-            // image upload quality.
-            switch imageUploadQuality {
-            case .original:
-                imageUploadQuality = .high
-            case .high:
-                imageUploadQuality = .mediumHigh
-            case .mediumHigh:
-                imageUploadQuality = .medium
-            case .medium:
-                imageUploadQuality = .mediumLow
-            case .mediumLow:
-                imageUploadQuality = .low
-            case .low:
+            // If the JPEG output is larger than the file size limit
+            // (i.e. the planned quality was too optimistic), continue
+            // to try again by progressively reducing the image upload
+            // quality.
+            guard let lowerImageUploadQuality = lowerImageQualityTier(than: imageUploadQuality) else {
                 attachment.error = .fileSizeTooLarge
                 return attachment
             }
+            imageUploadQuality = lowerImageUploadQuality
         }
     }
 
+    // The maximum size of the probe image used to plan the image upload quality.
+    private static let kImageProbeMaxSize: CGFloat = 512
+    // The fraction of the file size limit the planned output is allowed to use,
+    // to leave some room for prediction errors.
+    private static let kImagePlanningSizeMargin: Double = 0.9
+
+    // Predicts the highest image upload quality whose JPEG output will fit within
+    // the file size limit, so that large photos usually only need to be encoded
+    // once at their final size.
+    //
+    // The prediction is based on the bytes per pixel of a small probe image
+    // encoded at each quality tier's compression quality. Downsampled images have
+    // more detail per pixel, so this tends to slightly overestimate the output size.
+    private class func plannedImageQualityTier(image: UIImage, imageSource: CGImageSource?, imageQuality: TSImageQuality) -> TSImageQualityTier {
+        let initialImageUploadQuality = imageQuality.imageQualityTier()
+        let maxDimension = max(image.size.width, image.size.height)
+        guard maxDimension > kImageProbeMaxSize,
+            let probeImage = imageDownsampled(image, imageSource: imageSource, toMaxSize: kImageProbeMaxSize),
+            let probeCGImage = probeImage.cgImage,
+            probeCGImage.width > 0 && probeCGImage.height > 0 else {
+            // Small images are cheap enough to just encode.
+            return initialImageUploadQuality
+        }
+        let probePixelCount = Double(probeCGImage.width * probeCGImage.height)
+        let maxByteCount = Double(maxFileSize(imageQuality: imageQuality)) * kImagePlanningSizeMargin
+
+        var imageUploadQuality = initialImageUploadQuality
+        while true {
+            let compressionQuality = jpegCompressionQuality(imageUploadQuality: imageUploadQuality)
+            Metrics.increment("signal_attachment.jpeg_probe_encodes")
+            guard let probeData = probeImage.jpegData(compressionQuality: compressionQuality) else {
+                return initialImageUploadQuality
+            }
+            let scale = min(1, maxSizeForImage(image: image, imageUploadQuality: imageUploadQuality) / maxDimension)
+            let pixelCount = Double(image.size.width * scale) * Double(image.size.height * scale)
+            let predictedByteCount = Double(probeData.count) / probePixelCount * pixelCount
+            guard predictedByteCount > maxByteCount,
+                let lowerImageUploadQuality = lowerImageQualityTier(than: imageUploadQuality) else {
+                return imageUploadQuality
+            }
+            imageUploadQuality = lowerImageUploadQuality
+        }
+    }
+
+    private class func lowerImageQualityTier(than imageUploadQuality: TSImageQualityTier) -> TSImageQualityTier? {
+        switch imageUploadQuality {
+        case .original:
+            return .high
+        case .high:
+            return .mediumHigh
+        case .mediumHigh:
+            return .medium
+        case .medium:
+            return .mediumLow
+        case .mediumLow:
+            return .low
+        case .low:
+            return nil
+        }
+    }
+
+    private class func imageSource(for dataSource: DataSource) -> CGImageSource? {
+        // Don't cache the full size decoded image; only the downsampled ones are used.
+        let options = [ kCGImageSourceShouldCache : false ] as CFDictionary
+        if let dataUrl = dataSource.dataUrl() {
+            return CGImageSourceCreateWithURL(dataUrl as CFURL, options)
+        }
+        return CGImageSourceCreateWithData(dataSource.data() as CFData, options)
+    }
+
+    // Uses a single ImageIO thumbnail decode if the image's source is available.
+    // For JPEGs this decodes at a reduced scale, which is much faster and uses far
+    // less memory than decoding the full size image and redrawing it.
+    private class func imageDownsampled(_ image: UIImage, imageSource: CGImageSource?, toMaxSize maxSize: CGFloat) -> UIImage? {
+        if let imageSource = imageSource {
+            let options: [CFString:Any] = [
+                kCGImageSourceCreateThumbnailFromImageAlways : true,
+                // Applies the EXIF orientation, which UIImage would otherwise have applied.
+                kCGImageSourceCreateThumbnailWithTransform : true,
+                kCGImageSourceShouldCacheImmediately : true,
+                kCGImageSourceThumbnailMaxPixelSize : maxSize
+            ]
+            if let cgImage = CGImageSourceCreateThumbnailAtIndex(imageSource, 0, options as CFDictionary) {
+                return UIImage(cgImage: cgImage)
+            }
+        }
+        return imageScaled(image, toMaxSize: maxSize)
+    }
+
     // NOTE: For unknown reasons, resizing images with UIGraphicsBeginImageContext()
     // crashes reliably in the share extension after screen lock's auth UI has been presented.
     // Resizing using a CGContext seems to work fine.
@@ -807,6 +893,19 @@ public class SignalAttachment: NSObject {
         }
     }
 
+    // The largest JPEG output that doesImageHaveAcceptableFileSize(dataSource:imageQuality:)
+    // and the overall image file size limit accept.
+    private class func maxFileSize(imageQuality: TSImageQuality) -> UInt {
+        switch imageQuality {
+        case .original:
+            return kMaxFileSizeImage
+        case .medium:
+            return min(kMaxFileSizeImage, UInt(1024 * 1024) - 1)
+        case .compact:
+            return min(kMaxFileSizeImage, UInt(400 * 1024) - 1)
+        }
+    }
+
     private class func maxSizeForImage(image: UIImage, imageUploadQuality: TSImageQualityTier) -> CGFloat {
         switch imageUploadQuality {
         case .original:
@@ -929,7 +1028,11 @@ public class SignalAttachment: NSObject {
         return videoDir
     }
 
-    public class func compressVideoAsMp4(dataSource: DataSource, dataUTI: String) -> (Promise<SignalAttachment>, AVAssetExportSession?) {
+    // The output's resolution, frame rate and bit rate are chosen based on the
+    // video's duration so that it fits within kMaxFileSizeVideo once it's been
+    // encrypted for upload. Videos that are too long to fit at an acceptable
+    // quality are rejected without transcoding.
+    public class func compressVideoAsMp4(dataSource: DataSource, dataUTI: String) -> (Promise<SignalAttachment>, VideoTranscoder?) {
         guard let url = dataSource.dataUrl() else {
             let attachment = SignalAttachment(dataSource: DataSourceValue.emptyDataSource(), dataUTI: dataUTI)
             attachment.error = .missingData
@@ -938,22 +1041,18 @@ public class SignalAttachment: NSObject {
 
         let asset = AVAsset(url: url)
 
-        guard let exportSession = AVAssetExportSession(asset: asset, presetName: AVAssetExportPresetMediumQuality) else {
+        let transcoder: VideoTranscoder
+        do {
+            transcoder = try VideoTranscoder(asset: asset, maxByteCount: OWSMediaUtils.kMaxFileSizeVideoBeforeEncryption)
+        } catch {
             let attachment = SignalAttachment(dataSource: DataSourceValue.emptyDataSource(), dataUTI: dataUTI)
-            attachment.error = .couldNotConvertToMpeg4
+            attachment.error = videoCompressionError(for: error)
             return (Promise.value(attachment), nil)
         }
 
-        exportSession.shouldOptimizeForNetworkUse = true
-        exportSession.outputFileType = AVFileType.mp4
-        exportSession.metadataItemFilter = AVMetadataItemFilter.forSharing()
-
         let exportURL = videoTempPath.appendingPathComponent(UUID().uuidString).appendingPathExtension("mp4")
-        exportSession.outputURL = exportURL
-
-        let (promise, resolver) = Promise<SignalAttachment>.pending()
 
-        exportSession.exportAsynchronously {
+        let promise = transcoder.transcode(to: exportURL).map { _ -> SignalAttachment in
             let baseFilename = dataSource.sourceFilename
             let mp4Filename = baseFilename?.filenameWithoutExtension.appendingFileExtension("mp4")
 
@@ -961,17 +1060,28 @@ public class SignalAttachment: NSObject {
                                                              shouldDeleteOnDeallocation: true) else {
                 let attachment = SignalAttachment(dataSource: DataSourceValue.emptyDataSource(), dataUTI: dataUTI)
                 attachment.error = .couldNotConvertToMpeg4
-                resolver.fulfill(attachment)
-                return
+                return attachment
             }
 
             dataSource.sourceFilename = mp4Filename
 
-            let attachment = SignalAttachment(dataSource: dataSource, dataUTI: kUTTypeMPEG4 as String)
-            resolver.fulfill(attachment)
+            return SignalAttachment(dataSource: dataSource, dataUTI: kUTTypeMPEG4 as String)
+        }.recover { error -> Promise<SignalAttachment> in
+            let attachment = SignalAttachment(dataSource: DataSourceValue.emptyDataSource(), dataUTI: dataUTI)
+            attachment.error = videoCompressionError(for: error)
+            return Promise.value(attachment)
         }
 
-        return (promise, exportSession)
+        return (promise, transcoder)
+    }
+
+    private class func videoCompressionError(for error: Error) -> SignalAttachmentError {
+        switch error {
+        case VideoTranscodeError.exceedsByteBudget:
+            return .fileSizeTooLarge
+        default:
+            return .couldNotConvertToMpeg4
+        }
     }
 
     @objc
@@ -980,19 +1090,19 @@ public class SignalAttachment: NSObject {
         public let attachmentPromise: AnyPromise
 
         @objc
-        public let exportSession: AVAssetExportSession?
+        public let transcoder: VideoTranscoder?
 
-        fileprivate init(attachmentPromise: Promise<SignalAttachment>, exportSession: AVAssetExportSession?) {
+        fileprivate init(attachmentPromise: Promise<SignalAttachment>, transcoder: VideoTranscoder?) {
             self.attachmentPromise = AnyPromise(attachmentPromise)
-            self.exportSession = exportSession
+            self.transcoder = transcoder
             super.init()
         }
     }
 
     @objc
     public class func compressVideoAsMp4(dataSource: DataSource, dataUTI: String) -> VideoCompressionResult {
-        let (attachmentPromise, exportSession) = compressVideoAsMp4(dataSource: dataSource, dataUTI: dataUTI)
-        return VideoCompressionResult(attachmentPromise: attachmentPromise, exportSession: exportSession)
+        let (attachmentPromise, transcoder) = compressVideoAsMp4(dataSource: dataSource, dataUTI: dataUTI)
+        return VideoCompressionResult(attachmentPromise: attachmentPromise, transcoder: transcoder)
     }
 
     @objc
@@ -1020,7 +1130,7 @@ public class SignalAttachment: NSObject {
             return false
         }
 
-        if dataSource.dataLength() <= kMaxFileSizeVideo {
+        if dataSource.dataLength() <= OWSMediaUtils.kMaxFileSizeVideoBeforeEncryption {
             return true
         }
         return false
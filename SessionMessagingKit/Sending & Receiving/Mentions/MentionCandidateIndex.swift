@@ -0,0 +1,100 @@
+/// An incrementally maintained index of the mention candidates in a thread. Display names are normalized once when they're
+/// inserted, and a bigram index is used to narrow down the candidates for a query before checking whether the query actually
+/// occurs in their names. This keeps queries fast in open groups with thousands of participants.
+///
+/// - Note: Not thread safe. `MentionsManager` only accesses instances from its index queue.
+internal final class MentionCandidateIndex {
+    let context: Contact.Context
+    private var candidates: [String:Candidate] = [:]
+    /// A mapping from bigram to the set of public keys of the candidates whose normalized display name contains it.
+    private var bigramIndex: [String:Set<String>] = [:]
+    /// Lazily computed and invalidated whenever a candidate is inserted or removed.
+    private var sortedCandidates: [Candidate]?
+
+    private struct Candidate {
+        let publicKey: String
+        let displayName: String
+        let normalizedDisplayName: String
+    }
+
+    init(context: Contact.Context) {
+        self.context = context
+    }
+
+    func contains(_ publicKey: String) -> Bool {
+        return candidates[publicKey] != nil
+    }
+
+    // MARK: Updating
+    func insert(_ publicKey: String, displayName: String) {
+        if let existingCandidate = candidates[publicKey] {
+            guard existingCandidate.displayName != displayName else { return }
+            remove(publicKey)
+        }
+        let candidate = Candidate(publicKey: publicKey, displayName: displayName, normalizedDisplayName: MentionCandidateIndex.normalize(displayName))
+        candidates[publicKey] = candidate
+        for bigram in MentionCandidateIndex.bigrams(of: candidate.normalizedDisplayName) {
+            bigramIndex[bigram, default: []].insert(publicKey)
+        }
+        sortedCandidates = nil
+    }
+
+    func remove(_ publicKey: String) {
+        guard let candidate = candidates.removeValue(forKey: publicKey) else { return }
+        for bigram in MentionCandidateIndex.bigrams(of: candidate.normalizedDisplayName) {
+            bigramIndex[bigram]?.remove(publicKey)
+            if bigramIndex[bigram]?.isEmpty == true { bigramIndex[bigram] = nil }
+        }
+        sortedCandidates = nil
+    }
+
+    // MARK: Querying
+    /// Returns at most `limit` candidates whose display name contains `query`, ranked by where in the display name the query
+    /// occurs and then alphabetically. Queries shorter than 2 characters match every candidate.
+    func getCandidates(matching query: String, excluding excludedPublicKey: String?, limit: Int) -> [Mention] {
+        guard query.count >= 2 else {
+            return getSortedCandidates().lazy.filter { $0.publicKey != excludedPublicKey }.prefix(limit).map { Mention(publicKey: $0.publicKey, displayName: $0.displayName) }
+        }
+        let normalizedQuery = MentionCandidateIndex.normalize(query)
+        // Start from the least common bigram in the query to keep the number of candidates that need to be checked small
+        var publicKeys: Set<String>?
+        for bigram in MentionCandidateIndex.bigrams(of: normalizedQuery) {
+            let matches = bigramIndex[bigram] ?? []
+            if publicKeys == nil || matches.count < publicKeys!.count { publicKeys = matches }
+            if matches.isEmpty { break }
+        }
+        var matches: [(candidate: Candidate, offset: Int)] = []
+        for publicKey in publicKeys ?? [] where publicKey != excludedPublicKey {
+            guard let candidate = candidates[publicKey],
+                let range = candidate.normalizedDisplayName.range(of: normalizedQuery) else { continue }
+            matches.append((candidate: candidate, offset: candidate.normalizedDisplayName.distance(from: candidate.normalizedDisplayName.startIndex, to: range.lowerBound)))
+        }
+        matches.sort { lhs, rhs in
+            guard lhs.offset == rhs.offset else { return lhs.offset < rhs.offset }
+            return lhs.candidate.displayName < rhs.candidate.displayName
+        }
+        return matches.prefix(limit).map { Mention(publicKey: $0.candidate.publicKey, displayName: $0.candidate.displayName) }
+    }
+
+    private func getSortedCandidates() -> [Candidate] {
+        if let sortedCandidates = sortedCandidates { return sortedCandidates }
+        let result = candidates.values.sorted { $0.displayName < $1.displayName }
+        sortedCandidates = result
+        return result
+    }
+
+    // MARK: Convenience
+    private static func normalize(_ displayName: String) -> String {
+        return displayName.lowercased()
+    }
+
+    private static func bigrams(of string: String) -> Set<String> {
+        let characters = Array(string)
+        guard characters.count >= 2 else { return [] }
+        var result: Set<String> = []
+        for i in 0..<(characters.count - 1) {
+            result.insert(String(characters[i]) + String(characters[i + 1]))
+        }
+        return result
+    }
+}
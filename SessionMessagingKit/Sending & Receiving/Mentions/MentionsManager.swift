@@ -8,51 +8,89 @@ public final class MentionsManager : NSObject {
     /// - Note: Should only be accessed from the main queue to avoid race conditions.
     @objc public static var userPublicKeyCache: [String:Set<String>] = [:]
 
+    /// A mapping from thread ID to the index of mention candidates for that thread.
+    ///
+    /// - Note: Should only be accessed from `indexQueue` to avoid race conditions.
+    private static var candidateIndexes: [String:MentionCandidateIndex] = [:]
+    private static let indexQueue = DispatchQueue(label: "MentionsManager.indexQueue", qos: .userInitiated) // It's important that this is a serial queue
+    private static var contactUpdatedObserver: NSObjectProtocol?
+
     internal static var storage: OWSPrimaryStorage { OWSPrimaryStorage.shared() }
 
     // MARK: Settings
     private static var userIDScanLimit: UInt = 512
+    private static let maxMentionCandidateCount = 100
 
     // MARK: Initialization
     private override init() { }
 
     // MARK: Implementation
+    /// Adds `publicKey` to the mention candidates of the given thread if the thread's cache has already been populated. Should be
+    /// called from the main queue.
     @objc public static func cache(_ publicKey: String, for threadID: String) {
-        if let cache = userPublicKeyCache[threadID] {
-            userPublicKeyCache[threadID] = cache.union([ publicKey ])
-        } else {
-            userPublicKeyCache[threadID] = [ publicKey ]
+        guard let cache = userPublicKeyCache[threadID], !cache.contains(publicKey) else { return }
+        userPublicKeyCache[threadID] = cache.union([ publicKey ])
+        indexQueue.async {
+            guard let index = candidateIndexes[threadID] else { return }
+            Storage.read { transaction in
+                insert(publicKey, into: index, using: transaction)
+            }
         }
     }
 
     @objc public static func getMentionCandidates(for query: String, in threadID: String) -> [Mention] {
-        // Prepare
         guard let cache = userPublicKeyCache[threadID] else { return [] }
-        var candidates: [Mention] = []
-        // Gather candidates
-        let openGroupV2 = Storage.shared.getV2OpenGroup(for: threadID)
-        storage.dbReadConnection.read { transaction in
-            candidates = cache.compactMap { publicKey in
-                let context: Contact.Context = (openGroupV2 != nil) ? .openGroup : .regular
-                let displayNameOrNil = Storage.shared.getContact(with: publicKey)?.displayName(for: context)
-                guard let displayName = displayNameOrNil else { return nil }
-                guard !displayName.hasPrefix("Anonymous") else { return nil }
-                return Mention(publicKey: publicKey, displayName: displayName)
-            }
+        let userPublicKey = getUserHexEncodedPublicKey()
+        return indexQueue.sync {
+            // The index is normally built in the background when the cache is populated, so this should rarely have to build it
+            let index = candidateIndexes[threadID] ?? buildCandidateIndex(for: threadID, with: cache)
+            return index.getCandidates(matching: query, excluding: userPublicKey, limit: maxMentionCandidateCount)
         }
-        candidates = candidates.filter { $0.publicKey != getUserHexEncodedPublicKey() }
-        // Sort alphabetically first
-        candidates.sort { $0.displayName < $1.displayName }
-        if query.count >= 2 {
-            // Filter out any non-matching candidates
-            candidates = candidates.filter { $0.displayName.lowercased().contains(query.lowercased()) }
-            // Sort based on where in the candidate the query occurs
-            candidates.sort {
-                $0.displayName.lowercased().range(of: query.lowercased())!.lowerBound < $1.displayName.lowercased().range(of: query.lowercased())!.lowerBound
+    }
+
+    /// Builds the mention candidate index for the given thread in the background, so that the first mention query doesn't have to.
+    /// Should be called from the main queue after `populateUserPublicKeyCacheIfNeeded(for:in:)`.
+    @objc public static func buildCandidateIndexIfNeeded(for threadID: String) {
+        guard let cache = userPublicKeyCache[threadID] else { return }
+        indexQueue.async {
+            guard candidateIndexes[threadID] == nil else { return }
+            buildCandidateIndex(for: threadID, with: cache)
+        }
+    }
+
+    /// Must be called on `indexQueue`.
+    @discardableResult
+    private static func buildCandidateIndex(for threadID: String, with publicKeys: Set<String>) -> MentionCandidateIndex {
+        let context: Contact.Context = (Storage.shared.getV2OpenGroup(for: threadID) != nil) ? .openGroup : .regular
+        let index = MentionCandidateIndex(context: context)
+        Storage.read { transaction in
+            publicKeys.forEach { insert($0, into: index, using: transaction) }
+        }
+        candidateIndexes[threadID] = index
+        observeContactUpdatesIfNeeded()
+        return index
+    }
+
+    /// Must be called on `indexQueue`.
+    private static func insert(_ publicKey: String, into index: MentionCandidateIndex, using transaction: YapDatabaseReadTransaction) {
+        guard let displayName = Storage.shared.getContact(with: publicKey, using: transaction)?.displayName(for: index.context),
+            !displayName.hasPrefix("Anonymous") else { return index.remove(publicKey) }
+        index.insert(publicKey, displayName: displayName)
+    }
+
+    /// Must be called on `indexQueue`.
+    private static func observeContactUpdatesIfNeeded() {
+        guard contactUpdatedObserver == nil else { return }
+        contactUpdatedObserver = NotificationCenter.default.addObserver(forName: .contactUpdated, object: nil, queue: nil) { notification in
+            guard let publicKey = notification.object as? String else { return }
+            indexQueue.async {
+                let indexes = candidateIndexes.values.filter { $0.contains(publicKey) }
+                guard !indexes.isEmpty else { return }
+                Storage.read { transaction in
+                    indexes.forEach { insert(publicKey, into: $0, using: transaction) }
+                }
             }
         }
-        // Return
-        return candidates
     }
 
     @objc public static func populateUserPublicKeyCacheIfNeeded(for threadID: String, in transaction: YapDatabaseReadTransaction? = nil) {
@@ -64,8 +102,12 @@ public final class MentionsManager : NSObject {
             } else {
                 guard userPublicKeyCache[threadID] == nil else { return }
                 let interactions = transaction.ext(TSMessageDatabaseViewExtensionName) as! YapDatabaseViewTransaction
-                interactions.enumerateKeysAndObjects(inGroup: threadID) { _, _, object, index, _ in
-                    guard let message = object as? TSIncomingMessage, index < userIDScanLimit else { return }
+                // Only the most recent interactions are scanned, so enumerate in reverse and stop once the limit is reached
+                var scanCount: UInt = 0
+                interactions.enumerateKeysAndObjects(inGroup: threadID, with: NSEnumerationOptions.reverse) { _, _, object, _, stop in
+                    guard scanCount < userIDScanLimit else { stop.pointee = true; return }
+                    scanCount += 1
+                    guard let message = object as? TSIncomingMessage else { return }
                     result.insert(message.authorId)
                 }
             }
@@ -78,8 +120,12 @@ public final class MentionsManager : NSObject {
                 populate(in: transaction)
             }
         }
-        if !result.isEmpty {
+        if !result.isEmpty && result != userPublicKeyCache[threadID] {
             userPublicKeyCache[threadID] = result
+            indexQueue.async {
+                guard candidateIndexes[threadID] != nil else { return }
+                buildCandidateIndex(for: threadID, with: result)
+            }
         }
     }
 }
@@ -313,6 +313,12 @@ extension MessageReceiver {
         if isMainAppAndActive {
             cancelTypingIndicatorsIfNeeded(for: message.sender!)
         }
+        // Keep the mention candidates for the thread up to date
+        if isMainAppAndActive, let sender = message.sender {
+            transaction.addCompletionQueue(DispatchQueue.main) {
+                MentionsManager.cache(sender, for: threadID)
+            }
+        }
         // Keep track of the open group server message ID ↔ message ID relationship
         if let serverID = message.openGroupServerMessageID, let tsMessage = TSMessage.fetch(uniqueId: tsMessageID, transaction: transaction) {
             tsMessage.openGroupServerMessageID = serverID
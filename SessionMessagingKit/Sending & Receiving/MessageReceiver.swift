@@ -51,8 +51,9 @@ public enum MessageReceiver {
     public static func parse(_ data: Data, openGroupMessageServerID: UInt64?, isRetry: Bool = false, using transaction: Any) throws -> (Message, SNProtoContent) {
         let userPublicKey = SNMessagingKitConfiguration.shared.storage.getUserPublicKey()
         let isOpenGroupMessage = (openGroupMessageServerID != nil)
-        // Parse the envelope
-        let envelope = try SNProtoEnvelope.parseData(data)
+        // Parse the envelope. Pollers hand over the envelope without parsing it, so this is where malformed envelopes are
+        // caught; don't retry those.
+        guard let envelope = try? SNProtoEnvelope.parseData(data) else { throw Error.invalidMessage }
         let storage = SNMessagingKitConfiguration.shared.storage
         // Decrypt the contents
         guard let ciphertext = envelope.content else { throw Error.noData }
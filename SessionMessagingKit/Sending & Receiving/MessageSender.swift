@@ -97,8 +97,10 @@ public final class MessageSender : NSObject {
     // MARK: Convenience
     public static func send(_ message: Message, to destination: Message.Destination, using transaction: Any) -> Promise<Void> {
         switch destination {
-        case .contact(_), .closedGroup(_): return sendToSnodeDestination(destination, message: message, using: transaction)
-        case .openGroup(_, _), .openGroupV2(_, _): return sendToOpenGroupDestination(destination, message: message, using: transaction)
+        case .contact(_), .closedGroup(_):
+            return Metrics.measure("message_sender.send.snode") { sendToSnodeDestination(destination, message: message, using: transaction) }
+        case .openGroup(_, _), .openGroupV2(_, _):
+            return Metrics.measure("message_sender.send.open_group") { sendToOpenGroupDestination(destination, message: message, using: transaction) }
         }
     }
 
@@ -195,7 +197,7 @@ public final class MessageSender : NSObject {
         let wrappedMessage: Data
         do {
             wrappedMessage = try MessageWrapper.wrap(type: kind, timestamp: message.sentTimestamp!,
-                senderPublicKey: senderPublicKey, base64EncodedContent: ciphertext.base64EncodedString())
+                senderPublicKey: senderPublicKey, content: ciphertext)
         } catch {
             SNLog("Couldn't wrap message due to error: \(error).")
             handleFailure(with: error, using: transaction)
@@ -354,6 +356,10 @@ public final class MessageSender : NSObject {
             // Start the disappearing messages timer if needed
             OWSDisappearingMessagesJob.shared().startAnyExpiration(for: tsMessage, expirationStartedAt: NSDate.millisecondTimestamp(), transaction: transaction)
         }
+        // Keep track of the last configuration that was sent so that identical ones aren't sent again
+        if let message = message as? ConfigurationMessage {
+            Storage.shared.setLastConfigurationSyncHash(to: message.contentHash, using: transaction)
+        }
         // Sync the message if:
         // • it's a visible message or an expiration timer update
         // • the destination was a contact
@@ -117,15 +117,11 @@ public final class ClosedGroupPoller : NSObject {
                 SNLog("Received \(rawMessages.count) new message(s) in closed group with public key: \(groupPublicKey).")
             }
             rawMessages.forEach { json in
-                guard let envelope = SNProtoEnvelope.from(json) else { return }
-                do {
-                    let data = try envelope.serializedData()
-                    let job = MessageReceiveJob(data: data, serverHash: json["hash"] as? String, isBackgroundPoll: false)
-                    SNMessagingKitConfiguration.shared.storage.write { transaction in
-                        SessionMessagingKit.JobQueue.shared.add(job, using: transaction)
-                    }
-                } catch {
-                    SNLog("Failed to deserialize envelope due to error: \(error).")
+                // The envelope is only parsed once, by MessageReceiver
+                guard let data = SNProtoEnvelope.serializedData(from: json) else { return }
+                let job = MessageReceiveJob(data: data, serverHash: json["hash"] as? String, isBackgroundPoll: false)
+                SNMessagingKitConfiguration.shared.storage.write { transaction in
+                    SessionMessagingKit.JobQueue.shared.add(job, using: transaction)
                 }
             }
         }
@@ -6,10 +6,18 @@ public final class OpenGroupPollerV2 : NSObject {
     private var timer: Timer? = nil
     private var hasStarted = false
     private var isPolling = false
+    /// Only accessed from `OpenGroupAPIV2.workQueue`.
+    private var pollCount: UInt = 0
+    /// Room to the number of consecutive polls that didn't return any changes for it. Only accessed from `OpenGroupAPIV2.workQueue`.
+    private var quietPollCounts: [String:UInt] = [:]
 
     // MARK: Settings
     private let pollInterval: TimeInterval = 4
     static let maxInactivityPeriod: Double = 14 * 24 * 60 * 60
+    /// The number of consecutive polls without changes after which a room's poll interval is doubled.
+    private let quietPollCountThreshold: UInt = 8
+    /// The maximum factor by which a quiet room's poll interval is stretched.
+    private let maxQuietPollIntervalMultiplier: UInt = 4
 
     // MARK: Lifecycle
     public init(for server: String) {
@@ -46,10 +54,18 @@ public final class OpenGroupPollerV2 : NSObject {
         self.isPolling = true
         let (promise, seal) = Promise<Void>.pending()
         promise.retainUntilComplete()
-        OpenGroupAPIV2.compactPoll(server).done(on: OpenGroupAPIV2.workQueue) { [weak self] bodies in
+        OpenGroupAPIV2.workQueue.async(.promise) { () -> Set<String> in
+            // Background polls are rare, so they always include every room
+            return isBackgroundPoll ? [] : self.getQuietRoomsToSkip()
+        }.then(on: OpenGroupAPIV2.workQueue) { [server = self.server] excludedRooms in
+            OpenGroupAPIV2.compactPoll(server, excluding: excludedRooms)
+        }.done(on: OpenGroupAPIV2.workQueue) { [weak self] bodies in
             guard let self = self else { return }
             self.isPolling = false
-            bodies.forEach { self.handleCompactPollBody($0, isBackgroundPoll: isBackgroundPoll) }
+            bodies.forEach { body in
+                self.quietPollCounts[body.room] = body.isEmpty ? (self.quietPollCounts[body.room] ?? 0) + 1 : 0
+                self.handleCompactPollBody(body, isBackgroundPoll: isBackgroundPoll)
+            }
             seal.fulfill(())
         }.catch(on: OpenGroupAPIV2.workQueue) { error in
             SNLog("Open group polling failed due to error: \(error).")
@@ -59,27 +75,45 @@ public final class OpenGroupPollerV2 : NSObject {
         return promise
     }
 
+    /// Rooms that haven't had any messages or deletions for a while are polled less often, so that a server with many
+    /// idle rooms doesn't pay for all of them on every tick. Must be called on `OpenGroupAPIV2.workQueue`.
+    private func getQuietRoomsToSkip() -> Set<String> {
+        pollCount += 1
+        // Forget about rooms that have been left since the last poll
+        let rooms = Set(SNMessagingKitConfiguration.shared.storage.getAllV2OpenGroups().values.filter { $0.server == server }.map { $0.room })
+        quietPollCounts = quietPollCounts.filter { rooms.contains($0.key) }
+        var result: Set<String> = []
+        for (room, quietPollCount) in quietPollCounts {
+            let exponent = min(quietPollCount / quietPollCountThreshold, 2)
+            let multiplier = min(UInt(1) << exponent, maxQuietPollIntervalMultiplier)
+            if pollCount % multiplier != 0 { result.insert(room) }
+        }
+        return result
+    }
+
     private func handleCompactPollBody(_ body: OpenGroupAPIV2.CompactPollResponseBody, isBackgroundPoll: Bool) {
         let storage = SNMessagingKitConfiguration.shared.storage
         // - Messages
         // Sorting the messages by server ID before importing them fixes an issue where messages that quote older messages can't find those older messages
         let openGroupID = "\(server).\(body.room)"
         let messages = body.messages.sorted { $0.serverID! < $1.serverID! } // Safe because messages with a nil serverID are filtered out
-        storage.write { transaction in
-            messages.forEach { message in
-                guard let data = Data(base64Encoded: message.base64EncodedData) else {
-                    return SNLog("Ignoring open group message with invalid encoding.")
-                }
-                let envelope = SNProtoEnvelope.builder(type: .sessionMessage, timestamp: message.sentTimestamp)
-                envelope.setContent(data)
-                envelope.setSource(message.sender!) // Safe because messages with a nil sender are filtered out
-                envelope.setServerTimestamp(message.sentTimestamp)
-                do {
-                    let data = try envelope.buildSerializedData()
-                    let (message, proto) = try MessageReceiver.parse(data, openGroupMessageServerID: UInt64(message.serverID!), isRetry: false, using: transaction)
-                    try MessageReceiver.handle(message, associatedWithProto: proto, openGroupID: openGroupID, isBackgroundPoll: isBackgroundPoll, using: transaction)
-                } catch {
-                    SNLog("Couldn't receive open group message due to error: \(error).")
+        if !messages.isEmpty {
+            storage.write { transaction in
+                messages.forEach { message in
+                    guard let data = Data(base64Encoded: message.base64EncodedData) else {
+                        return SNLog("Ignoring open group message with invalid encoding.")
+                    }
+                    let envelope = SNProtoEnvelope.builder(type: .sessionMessage, timestamp: message.sentTimestamp)
+                    envelope.setContent(data)
+                    envelope.setSource(message.sender!) // Safe because messages with a nil sender are filtered out
+                    envelope.setServerTimestamp(message.sentTimestamp)
+                    do {
+                        let data = try envelope.buildSerializedData()
+                        let (message, proto) = try MessageReceiver.parse(data, openGroupMessageServerID: UInt64(message.serverID!), isRetry: false, using: transaction)
+                        try MessageReceiver.handle(message, associatedWithProto: proto, openGroupID: openGroupID, isBackgroundPoll: isBackgroundPoll, using: transaction)
+                    } catch {
+                        SNLog("Couldn't receive open group message due to error: \(error).")
+                    }
                 }
             }
         }
@@ -91,6 +125,7 @@ public final class OpenGroupPollerV2 : NSObject {
             OpenGroupAPIV2.moderators[server] = [ body.room : Set(body.moderators) ]
         }
         // - Deletions
+        guard !body.deletions.isEmpty else { return }
         let deletedMessageServerIDs = Set(body.deletions.map { UInt64($0.deletedMessageID) })
         storage.write { transaction in
             let transaction = transaction as! YapDatabaseReadWriteTransaction
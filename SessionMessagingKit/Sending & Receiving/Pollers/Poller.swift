@@ -74,6 +74,7 @@ public final class Poller : NSObject {
                 if let error = error as? Error, error == .pollLimitReached {
                     self?.pollCount = 0
                 } else {
+                    Metrics.increment("poller.failures")
                     SNLog("Polling \(nextSnode) failed; dropping it and switching to next snode.")
                     SnodeAPI.dropSnodeFromSwarmIfNeeded(nextSnode, publicKey: userPublicKey)
                 }
@@ -87,22 +88,21 @@ public final class Poller : NSObject {
     private func poll(_ snode: Snode, seal longTermSeal: Resolver<Void>) -> Promise<Void> {
         guard isPolling else { return Promise { $0.fulfill(()) } }
         let userPublicKey = getUserHexEncodedPublicKey()
-        return SnodeAPI.getRawMessages(from: snode, associatedWith: userPublicKey).then(on: DispatchQueue.main) { [weak self] rawResponse -> Promise<Void> in
+        let rawMessagesPromise = SnodeAPI.getRawMessages(from: snode, associatedWith: userPublicKey)
+        Metrics.beginSpan("poller.poll")?.end(after: rawMessagesPromise) // Failed polls are also counted separately
+        return rawMessagesPromise.then(on: DispatchQueue.main) { [weak self] rawResponse -> Promise<Void> in
             guard let strongSelf = self, strongSelf.isPolling else { return Promise { $0.fulfill(()) } }
             let messages = SnodeAPI.parseRawMessagesResponse(rawResponse, from: snode, associatedWith: userPublicKey)
+            Metrics.record("poller.message_count", value: UInt64(messages.count))
             if !messages.isEmpty {
                 SNLog("Received \(messages.count) new message(s).")
             }
             messages.forEach { json in
-                guard let envelope = SNProtoEnvelope.from(json) else { return }
-                do {
-                    let data = try envelope.serializedData()
-                    let job = MessageReceiveJob(data: data, serverHash: json["hash"] as? String, isBackgroundPoll: false)
-                    SNMessagingKitConfiguration.shared.storage.write { transaction in
-                        SessionMessagingKit.JobQueue.shared.add(job, using: transaction)
-                    }
-                } catch {
-                    SNLog("Failed to deserialize envelope due to error: \(error).")
+                // The envelope is only parsed once, by MessageReceiver
+                guard let data = SNProtoEnvelope.serializedData(from: json) else { return }
+                let job = MessageReceiveJob(data: data, serverHash: json["hash"] as? String, isBackgroundPoll: false)
+                SNMessagingKitConfiguration.shared.storage.write { transaction in
+                    SessionMessagingKit.JobQueue.shared.add(job, using: transaction)
                 }
             }
             strongSelf.pollCount += 1
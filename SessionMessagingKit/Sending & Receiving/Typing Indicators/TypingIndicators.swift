@@ -164,6 +164,8 @@ public class TypingIndicatorsImpl : NSObject, TypingIndicators {
     // Map of thread id-to-OutgoingIndicators.
     private var outgoingIndicatorsMap = [String: OutgoingIndicators]()
 
+    private let outgoingIndicatorsScheduler = OutgoingIndicatorsScheduler()
+
     private func ensureOutgoingIndicators(forThread thread: TSThread) -> OutgoingIndicators? {
         guard let threadId = thread.uniqueId else {
             return nil
@@ -171,7 +173,7 @@ public class TypingIndicatorsImpl : NSObject, TypingIndicators {
         if let outgoingIndicators = outgoingIndicatorsMap[threadId] {
             return outgoingIndicators
         }
-        let outgoingIndicators = OutgoingIndicators(delegate: self, thread: thread)
+        let outgoingIndicators = OutgoingIndicators(delegate: self, scheduler: outgoingIndicatorsScheduler, thread: thread)
         outgoingIndicatorsMap[threadId] = outgoingIndicators
         return outgoingIndicators
     }
@@ -182,12 +184,14 @@ public class TypingIndicatorsImpl : NSObject, TypingIndicators {
     // A sendRefresh timer
     private class OutgoingIndicators {
         private weak var delegate: TypingIndicators?
+        private let scheduler: OutgoingIndicatorsScheduler
         private let thread: TSThread
         private var sendPauseTimer: Timer?
         private var sendRefreshTimer: Timer?
 
-        init(delegate: TypingIndicators, thread: TSThread) {
+        init(delegate: TypingIndicators, scheduler: OutgoingIndicatorsScheduler, thread: TSThread) {
             self.delegate = delegate
+            self.scheduler = scheduler
             self.thread = thread
         }
 
@@ -256,6 +260,9 @@ public class TypingIndicatorsImpl : NSObject, TypingIndicators {
 
             sendPauseTimer?.invalidate()
             sendPauseTimer = nil
+
+            // The recipient stops showing the typing indicator when they receive the message
+            scheduler.didSendOutgoingMessage(inThread: thread)
         }
 
         private func sendTypingMessageIfNecessary(forThread thread: TSThread, action: TypingIndicator.Kind) {
@@ -271,11 +278,117 @@ public class TypingIndicatorsImpl : NSObject, TypingIndicators {
 
             if thread.isGroupThread() { return } // Don't send typing indicators in group threads
 
-            let typingIndicator = TypingIndicator()
-            typingIndicator.kind = action
+            scheduler.schedule(action, inThread: thread)
+        }
+    }
+
+    // Every outgoing typing indicator is a full message send, so they're all funnelled through here. An indicator
+    // is only sent if it changes what the recipient is shown, started indicators are rate limited per thread using
+    // a token bucket, indicators scheduled in quick succession are sent in a single write transaction and indicators
+    // that would arrive too late to be meaningful are dropped.
+    private class OutgoingIndicatorsScheduler {
+        private var pendingIndicators = [String: PendingIndicator]()
+        // The threads for which the recipient is currently being shown a typing indicator, as far as we know.
+        private var startedThreadIds = Set<String>()
+        private var tokenBuckets = [String: TokenBucket]()
+        private var isFlushScheduled = false
+
+        private static let maxTokenCount: Double = 3
+        private static let tokenRefillInterval: TimeInterval = 5
+        // How long indicators are collected before they're sent, so that e.g. a start immediately followed by a stop
+        // doesn't result in any messages being sent.
+        private static let flushDelay: TimeInterval = 0.25
+        // An indicator that hasn't been handed to the message sender within this time is dropped; the recipient only
+        // displays a started indicator for 5 seconds, and the next refresh or pause will send a more current one.
+        private static let maxIndicatorAge: TimeInterval = 3
+
+        private struct PendingIndicator {
+            let thread: TSThread
+            let action: TypingIndicator.Kind
+            let deadline: Date
+        }
+
+        private struct TokenBucket {
+            var tokenCount: Double
+            var lastRefillDate: Date
+        }
+
+        func schedule(_ action: TypingIndicator.Kind, inThread thread: TSThread) {
+            AssertIsOnMainThread()
+            guard let threadId = thread.uniqueId else {
+                return
+            }
+            // Only the latest state matters
+            pendingIndicators[threadId] = PendingIndicator(thread: thread, action: action, deadline: Date().addingTimeInterval(OutgoingIndicatorsScheduler.maxIndicatorAge))
+            guard !isFlushScheduled else {
+                return
+            }
+            isFlushScheduled = true
+            DispatchQueue.main.asyncAfter(deadline: .now() + OutgoingIndicatorsScheduler.flushDelay) {
+                self.flush()
+            }
+        }
+
+        func didSendOutgoingMessage(inThread thread: TSThread) {
+            AssertIsOnMainThread()
+            guard let threadId = thread.uniqueId else {
+                return
+            }
+            pendingIndicators[threadId] = nil
+            startedThreadIds.remove(threadId)
+        }
+
+        private func flush() {
+            isFlushScheduled = false
+            let now = Date()
+            var indicatorsToSend = [PendingIndicator]()
+            for (threadId, indicator) in pendingIndicators {
+                guard now < indicator.deadline else {
+                    continue
+                }
+                switch indicator.action {
+                case .started:
+                    guard consumeToken(forThread: threadId, at: now) else {
+                        Logger.debug("Dropping typing indicator for rate limited thread: \(threadId).")
+                        continue
+                    }
+                    startedThreadIds.insert(threadId)
+                case .stopped:
+                    // There's nothing to stop if the recipient isn't being shown a typing indicator
+                    guard startedThreadIds.remove(threadId) != nil else {
+                        continue
+                    }
+                }
+                indicatorsToSend.append(indicator)
+            }
+            pendingIndicators.removeAll()
+            guard !indicatorsToSend.isEmpty else {
+                return
+            }
             SNMessagingKitConfiguration.shared.storage.write { transaction in
-                MessageSender.send(typingIndicator, in: thread, using: transaction as! YapDatabaseReadWriteTransaction)
+                for indicator in indicatorsToSend {
+                    // The write might've been delayed by other database activity
+                    guard Date() < indicator.deadline else {
+                        continue
+                    }
+                    let typingIndicator = TypingIndicator()
+                    typingIndicator.kind = indicator.action
+                    MessageSender.send(typingIndicator, in: indicator.thread, using: transaction as! YapDatabaseReadWriteTransaction)
+                }
+            }
+        }
+
+        private func consumeToken(forThread threadId: String, at date: Date) -> Bool {
+            var tokenBucket = tokenBuckets[threadId] ?? TokenBucket(tokenCount: OutgoingIndicatorsScheduler.maxTokenCount, lastRefillDate: date)
+            let refillCount = date.timeIntervalSince(tokenBucket.lastRefillDate) / OutgoingIndicatorsScheduler.tokenRefillInterval
+            tokenBucket.tokenCount = min(tokenBucket.tokenCount + refillCount, OutgoingIndicatorsScheduler.maxTokenCount)
+            tokenBucket.lastRefillDate = date
+            let hasToken = tokenBucket.tokenCount >= 1
+            if hasToken {
+                tokenBucket.tokenCount -= 1
             }
+            tokenBuckets[threadId] = tokenBucket
+            return hasToken
         }
     }
 
@@ -42,6 +42,7 @@ public protocol SessionMessagingKitStorageProtocol {
     func getAuthToken(for room: String, on server: String) -> String?
     func setAuthToken(for room: String, on server: String, to newValue: String, using transaction: Any)
     func removeAuthToken(for room: String, on server: String, using transaction: Any)
+    func getAuthTokenDate(for room: String, on server: String) -> Date?
 
     // MARK: - Open Groups
 
@@ -74,6 +75,9 @@ public protocol SessionMessagingKitStorageProtocol {
     // MARK: - Message Handling
 
     func getReceivedMessageTimestamps(using transaction: Any) -> [UInt64]
+    /// The `contentHash` of the last configuration message that was successfully sent.
+    func getLastConfigurationSyncHash() -> String?
+    func setLastConfigurationSyncHash(to newValue: String, using transaction: Any)
     func addReceivedMessageTimestamp(_ timestamp: UInt64, using transaction: Any)
     /// Returns the ID of the thread.
     func getOrCreateThread(for publicKey: String, groupPublicKey: String?, openGroupID: String?, using transaction: Any) -> String?
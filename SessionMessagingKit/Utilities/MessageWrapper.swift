@@ -20,9 +20,11 @@ public enum MessageWrapper {
     }
 
     /// Wraps the given parameters in an `SNProtoEnvelope` and then a `WebSocketProtoWebSocketMessage` to match the desktop application.
-    public static func wrap(type: SNProtoEnvelope.SNProtoEnvelopeType, timestamp: UInt64, senderPublicKey: String, base64EncodedContent: String) throws -> Data {
+    ///
+    /// - Note: `content` shouldn't be base 64 encoded.
+    public static func wrap(type: SNProtoEnvelope.SNProtoEnvelopeType, timestamp: UInt64, senderPublicKey: String, content: Data) throws -> Data {
         do {
-            let envelope = try createEnvelope(type: type, timestamp: timestamp, senderPublicKey: senderPublicKey, base64EncodedContent: base64EncodedContent)
+            let envelope = try createEnvelope(type: type, timestamp: timestamp, senderPublicKey: senderPublicKey, content: content)
             let webSocketMessage = try createWebSocketMessage(around: envelope)
             return try webSocketMessage.serializedData()
         } catch let error {
@@ -30,16 +32,12 @@ public enum MessageWrapper {
         }
     }
 
-    private static func createEnvelope(type: SNProtoEnvelope.SNProtoEnvelopeType, timestamp: UInt64, senderPublicKey: String, base64EncodedContent: String) throws -> SNProtoEnvelope {
+    private static func createEnvelope(type: SNProtoEnvelope.SNProtoEnvelopeType, timestamp: UInt64, senderPublicKey: String, content: Data) throws -> SNProtoEnvelope {
         do {
             let builder = SNProtoEnvelope.builder(type: type, timestamp: timestamp)
             builder.setSource(senderPublicKey)
             builder.setSourceDevice(1)
-            if let content = Data(base64Encoded: base64EncodedContent, options: .ignoreUnknownCharacters) {
-                builder.setContent(content)
-            } else {
-                throw Error.failedToWrapMessageInEnvelope
-            }
+            builder.setContent(content)
             return try builder.build()
         } catch let error {
             SNLog("Failed to wrap message in envelope: \(error).")
@@ -62,10 +60,24 @@ public enum MessageWrapper {
 
     /// - Note: `data` shouldn't be base 64 encoded.
     public static func unwrap(data: Data) throws -> SNProtoEnvelope {
+        let envelopeData = try unwrapEnvelopeData(from: data)
+        do {
+            return try SNProtoEnvelope.parseData(envelopeData)
+        } catch let error {
+            SNLog("Failed to unwrap data: \(error).")
+            throw Error.failedToUnwrapData
+        }
+    }
+
+    /// Returns the serialized envelope without parsing it. Use this when the envelope is going to be handed to
+    /// `MessageReceiver.parse(_:openGroupMessageServerID:isRetry:using:)`, which parses it anyway.
+    ///
+    /// - Note: `data` shouldn't be base 64 encoded.
+    public static func unwrapEnvelopeData(from data: Data) throws -> Data {
         do {
             let webSocketMessage = try WebSocketProtoWebSocketMessage.parseData(data)
-            let envelope = webSocketMessage.request!.body!
-            return try SNProtoEnvelope.parseData(envelope)
+            guard let envelopeData = webSocketMessage.request?.body else { throw Error.failedToUnwrapData }
+            return envelopeData
         } catch let error {
             SNLog("Failed to unwrap data: \(error).")
             throw Error.failedToUnwrapData
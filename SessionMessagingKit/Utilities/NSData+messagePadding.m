@@ -9,22 +9,30 @@
 @implementation NSData (messagePadding)
 
 - (NSData *)removePadding {
-    unsigned long paddingStart = self.length;
-
-    Byte data[self.length];
-    [self getBytes:data length:self.length];
-
-    for (long i = (long)self.length - 1; i >= 0; i--) {
-        if (data[i] == (Byte)0x80) {
-            paddingStart = (unsigned long)i;
+    const Byte *bytes = self.bytes;
+    NSUInteger end = self.length;
+
+    // Skip over trailing zeros a word at a time. This reads the bytes in place rather than copying the whole message first.
+    while (end >= sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, bytes + end - sizeof(uint64_t), sizeof(uint64_t));
+        if (word != 0) {
             break;
-        } else if (data[i] != (Byte)0x00) {
-            OWSLogWarn(@"Failed to remove padding, returning unstripped padding");
-            return self;
         }
+        end -= sizeof(uint64_t);
+    }
+    while (end > 0 && bytes[end - 1] == (Byte)0x00) {
+        end--;
+    }
+
+    if (end == 0) {
+        return self;
+    } else if (bytes[end - 1] != (Byte)0x80) {
+        OWSLogWarn(@"Failed to remove padding, returning unstripped padding");
+        return self;
     }
 
-    return [self subdataWithRange:NSMakeRange(0, paddingStart)];
+    return [self subdataWithRange:NSMakeRange(0, end - 1)];
 }
 
 
@@ -36,12 +44,14 @@
     // otherwise it'll add a full 16 extra bytes.
 
     NSUInteger paddedMessageLength = [self paddedMessageLength:(self.length + 1)] - 1;
-    NSMutableData *paddedMessage   = [NSMutableData dataWithLength:paddedMessageLength];
+    NSMutableData *paddedMessage   = [NSMutableData dataWithCapacity:paddedMessageLength];
 
     Byte paddingByte = 0x80;
 
-    [paddedMessage replaceBytesInRange:NSMakeRange(0, self.length) withBytes:[self bytes]];
-    [paddedMessage replaceBytesInRange:NSMakeRange(self.length, 1) withBytes:&paddingByte];
+    // Append rather than zero-filling the whole buffer up front; only the padding bytes need to be zeroed
+    [paddedMessage appendData:self];
+    [paddedMessage appendBytes:&paddingByte length:1];
+    [paddedMessage setLength:paddedMessageLength];
 
     return paddedMessage;
 }
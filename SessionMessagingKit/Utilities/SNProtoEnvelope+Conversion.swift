@@ -1,12 +1,13 @@
 
 public extension SNProtoEnvelope {
 
-    static func from(_ json: JSON) -> SNProtoEnvelope? {
+    /// Returns the serialized envelope contained in the given raw message, without parsing it.
+    static func serializedData(from json: JSON) -> Data? {
         guard let base64EncodedData = json["data"] as? String, let data = Data(base64Encoded: base64EncodedData) else {
             SNLog("Failed to decode data for message: \(json).")
             return nil
         }
-        guard let result = try? MessageWrapper.unwrap(data: data) else {
+        guard let result = try? MessageWrapper.unwrapEnvelopeData(from: data) else {
             SNLog("Failed to unwrap data for message: \(json).")
             return nil
         }
@@ -30,7 +30,7 @@ public final class NotificationServiceExtension : UNNotificationServiceExtension
         AppReadiness.runNowOrWhenAppDidBecomeReady {
             let notificationContent = self.notificationContent!
             guard let base64EncodedData = notificationContent.userInfo["ENCRYPTED_DATA"] as! String?, let data = Data(base64Encoded: base64EncodedData),
-                let envelope = try? MessageWrapper.unwrap(data: data), let envelopeAsData = try? envelope.serializedData() else {
+                let envelopeAsData = try? MessageWrapper.unwrapEnvelopeData(from: data) else {
                 return self.handleFailure(for: notificationContent)
             }
             Storage.write { transaction in // Intentionally capture self
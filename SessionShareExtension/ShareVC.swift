@@ -4,6 +4,8 @@ import SessionUIKit
 
 final class ShareVC : UINavigationController, ShareViewDelegate, AppModeManagerDelegate {
     private var areVersionMigrationsComplete = false
+    /// The transcoders for shared videos that are being converted. Should only be accessed on the main thread.
+    private var videoTranscoders: [VideoTranscoder] = []
     public static var attachmentPrepPromise: Promise<[SignalAttachment]>?
     
     // MARK: Error
@@ -192,7 +194,12 @@ final class ShareVC : UINavigationController, ShareViewDelegate, AppModeManagerD
         threadPickerVC.shareVC = self
         setViewControllers([ threadPickerVC ], animated: false)
         let promise = buildAttachments()
-        ModalActivityIndicatorViewController.present(fromViewController: self, canCancel: false, message: NSLocalizedString("vc_share_loading_message", comment: "")) { activityIndicator in
+        ModalActivityIndicatorViewController.present(fromViewController: self, canCancel: true, message: NSLocalizedString("vc_share_loading_message", comment: "")) { [weak self] activityIndicator in
+            DispatchQueue.main.async {
+                // Converting videos can take a while, so let the user back out of the share
+                guard !activityIndicator.wasCancelled else { self?.shareViewWasCancelled(); return }
+                activityIndicator.onCancel = { self?.shareViewWasCancelled() }
+            }
             promise.done { _ in
                 activityIndicator.dismiss { }
             }.catch { _ in
@@ -211,6 +218,7 @@ final class ShareVC : UINavigationController, ShareViewDelegate, AppModeManagerD
     }
     
     func shareViewWasCancelled() {
+        videoTranscoders.forEach { $0.cancel() }
         extensionContext!.completeRequest(returningItems: [], completionHandler: nil)
     }
     
@@ -548,7 +556,10 @@ final class ShareVC : UINavigationController, ShareViewDelegate, AppModeManagerD
 
         guard !SignalAttachment.isInvalidVideo(dataSource: dataSource, dataUTI: specificUTIType) else {
             // This can happen, e.g. when sharing a quicktime-video from iCloud drive.
-            let (promise, _) = SignalAttachment.compressVideoAsMp4(dataSource: dataSource, dataUTI: specificUTIType)
+            let (promise, transcoder) = SignalAttachment.compressVideoAsMp4(dataSource: dataSource, dataUTI: specificUTIType)
+            if let transcoder = transcoder {
+                videoTranscoders.append(transcoder)
+            }
             return promise
         }
 
@@ -1,13 +1,19 @@
 
 public struct SNSnodeKitConfiguration {
     public let storage: SessionSnodeKitStorageProtocol
+    /// Overrides the default seed nodes, e.g. to point the app at a local snode network.
+    public let seedNodePool: Set<String>?
+
+    /// When the seed nodes are overridden the snode pool, swarms and onion request paths of the network the app was
+    /// previously using don't apply, so they're neither loaded from nor saved to the database.
+    internal var isSeedNodePoolOverridden: Bool { seedNodePool != nil }
 
     internal static var shared: SNSnodeKitConfiguration!
 }
 
 public enum SNSnodeKit { // Just to make the external API nice
 
-    public static func configure(storage: SessionSnodeKitStorageProtocol) {
-        SNSnodeKitConfiguration.shared = SNSnodeKitConfiguration(storage: storage)
+    public static func configure(storage: SessionSnodeKitStorageProtocol, seedNodePool: Set<String>? = nil) {
+        SNSnodeKitConfiguration.shared = SNSnodeKitConfiguration(storage: storage, seedNodePool: seedNodePool)
     }
 }
@@ -151,10 +151,7 @@ public enum OnionRequestAPI {
             }
         }.map2 { paths in
             OnionRequestAPI.paths = paths + reusablePaths
-            SNSnodeKitConfiguration.shared.storage.writeSync { transaction in
-                SNLog("Persisting onion request paths to database.")
-                SNSnodeKitConfiguration.shared.storage.setOnionRequestPaths(to: paths, using: transaction)
-            }
+            persist(paths)
             DispatchQueue.main.async {
                 NotificationCenter.default.post(name: .pathsBuilt, object: nil)
             }
@@ -166,11 +163,12 @@ public enum OnionRequestAPI {
         return promise
     }
 
-    /// Returns a `Path` to be used for building an onion request. Builds new paths as needed.
-    private static func getPath(excluding snode: Snode?) -> Promise<Path> {
+    /// Returns a `Path` to be used for building an onion request. Builds new paths as needed. Paths with one of the given guard
+    /// snodes are avoided if any other paths are available.
+    private static func getPath(excluding snode: Snode?, excludingGuardSnodes excludedGuardSnodes: Set<Snode> = []) -> Promise<Path> {
         guard pathSize >= 1 else { preconditionFailure("Can't build path of size zero.") }
         var paths = OnionRequestAPI.paths
-        if paths.isEmpty {
+        if paths.isEmpty && !SNSnodeKitConfiguration.shared.isSeedNodePoolOverridden {
             paths = SNSnodeKitConfiguration.shared.storage.getOnionRequestPaths()
             OnionRequestAPI.paths = paths
             if !paths.isEmpty {
@@ -180,6 +178,10 @@ public enum OnionRequestAPI {
                 }
             }
         }
+        if !excludedGuardSnodes.isEmpty {
+            let candidates = paths.filter { !excludedGuardSnodes.contains($0[0]) && (snode == nil || !$0.contains(snode!)) }
+            if let path = candidates.randomElement() { return Promise { $0.fulfill(path) } }
+        }
         // randomElement() uses the system's default random generator, which is cryptographically secure
         if paths.count >= targetPathCount {
             if let snode = snode {
@@ -240,10 +242,7 @@ public enum OnionRequestAPI {
         oldPaths.remove(at: pathIndex)
         let newPaths = oldPaths + [ path ]
         paths = newPaths
-        SNSnodeKitConfiguration.shared.storage.writeSync { transaction in
-            SNLog("Persisting onion request paths to database.")
-            SNSnodeKitConfiguration.shared.storage.setOnionRequestPaths(to: newPaths, using: transaction)
-        }
+        persist(newPaths)
     }
 
     private static func drop(_ path: Path) {
@@ -255,25 +254,30 @@ public enum OnionRequestAPI {
         guard let pathIndex = paths.firstIndex(of: path) else { return }
         paths.remove(at: pathIndex)
         OnionRequestAPI.paths = paths
+        persist(paths)
+    }
+
+    private static func persist(_ paths: [Path]) {
+        // Paths through an overridden network (e.g. a local one) shouldn't outlive the override
+        guard !SNSnodeKitConfiguration.shared.isSeedNodePoolOverridden else { return }
         SNSnodeKitConfiguration.shared.storage.writeSync { transaction in
             if !paths.isEmpty {
                 SNLog("Persisting onion request paths to database.")
-                SNSnodeKitConfiguration.shared.storage.setOnionRequestPaths(to: paths, using: transaction)
             } else {
                 SNLog("Clearing onion request paths.")
-                SNSnodeKitConfiguration.shared.storage.setOnionRequestPaths(to: [], using: transaction)
             }
+            SNSnodeKitConfiguration.shared.storage.setOnionRequestPaths(to: paths, using: transaction)
         }
     }
 
     /// Builds an onion around `payload` and returns the result.
-    private static func buildOnion(around payload: JSON, targetedAt destination: Destination) -> Promise<OnionBuildingResult> {
+    private static func buildOnion(around payload: JSON, targetedAt destination: Destination, excludingGuardSnodes excludedGuardSnodes: Set<Snode>) -> Promise<OnionBuildingResult> {
         var guardSnode: Snode!
         var targetSnodeSymmetricKey: Data! // Needed by invoke(_:on:with:) to decrypt the response sent back by the destination
         var encryptionResult: AESGCM.EncryptionResult!
         var snodeToExclude: Snode?
         if case .snode(let snode) = destination { snodeToExclude = snode }
-        return getPath(excluding: snodeToExclude).then2 { path -> Promise<AESGCM.EncryptionResult> in
+        return getPath(excluding: snodeToExclude, excludingGuardSnodes: excludedGuardSnodes).then2 { path -> Promise<AESGCM.EncryptionResult> in
             guardSnode = path.first!
             // Encrypt in reverse order, i.e. the destination first
             return encrypt(payload, for: destination).then2 { r -> Promise<AESGCM.EncryptionResult> in
@@ -311,6 +315,14 @@ public enum OnionRequestAPI {
 
     /// Sends an onion request to `server`. Builds new paths as needed.
     public static func sendOnionRequest(_ request: NSURLRequest, to server: String, target: String = "/loki/v3/lsrpc", using x25519PublicKey: String) -> Promise<JSON> {
+        return sendOnionRequest(request, to: server, target: target, using: x25519PublicKey, maxRetryCount: 0, isIdempotent: false)
+    }
+
+    /// Sends an onion request to `server`, retrying up to `maxRetryCount` times if it failed on its way to the server. Each retry
+    /// avoids the paths that already failed, and the request isn't retried if no other path is available. Timeouts are ambiguous
+    /// (the server might have received the request), so they're only retried if `isIdempotent` is set.
+    public static func sendOnionRequest(_ request: NSURLRequest, to server: String, target: String = "/loki/v3/lsrpc", using x25519PublicKey: String,
+        maxRetryCount: UInt, isIdempotent: Bool) -> Promise<JSON> {
         var rawHeaders = request.allHTTPHeaderFields ?? [:]
         rawHeaders.removeValue(forKey: "User-Agent")
         var headers: JSON = rawHeaders.mapValues { value in
@@ -352,7 +364,23 @@ public enum OnionRequestAPI {
             "headers" : headers
         ]
         let destination = Destination.server(host: host, target: target, x25519PublicKey: x25519PublicKey, scheme: scheme, port: port)
-        let promise = sendOnionRequest(with: payload, to: destination)
+        var excludedGuardSnodes: Set<Snode> = []
+        var retryCount: UInt = 0
+        func attempt() -> Promise<JSON> {
+            var guardSnode: Snode?
+            return sendOnionRequest(with: payload, to: destination, excludingGuardSnodes: excludedGuardSnodes) { guardSnode = $0 }
+            .recover(on: Threading.workQueue) { error -> Promise<JSON> in
+                // Only retry failures that happened on the path; errors from the destination or from path building won't be fixed by a retry
+                guard retryCount < maxRetryCount, let guardSnode = guardSnode,
+                    case HTTP.Error.httpRequestFailed(let statusCode, _) = error, statusCode != 0 || isIdempotent else { throw error }
+                excludedGuardSnodes.insert(guardSnode)
+                guard paths.contains(where: { !excludedGuardSnodes.contains($0[0]) }) else { throw error }
+                retryCount += 1
+                SNLog("Onion request to: \(host) failed due to error: \(error); retrying over a different path.")
+                return attempt()
+            }
+        }
+        let promise = attempt()
         promise.catch2 { error in
             SNLog("Couldn't reach server: \(url) due to error: \(error).")
         }
@@ -360,11 +388,23 @@ public enum OnionRequestAPI {
     }
 
     public static func sendOnionRequest(with payload: JSON, to destination: Destination) -> Promise<JSON> {
+        return sendOnionRequest(with: payload, to: destination, excludingGuardSnodes: [], onGuardSnodeSelected: nil)
+    }
+
+    /// `onGuardSnodeSelected` is invoked on `Threading.workQueue` with the guard snode of the path the request is sent over.
+    private static func sendOnionRequest(with payload: JSON, to destination: Destination, excludingGuardSnodes excludedGuardSnodes: Set<Snode>,
+        onGuardSnodeSelected: ((Snode) -> Void)?) -> Promise<JSON> {
         let (promise, seal) = Promise<JSON>.pending()
+        let hopCount = pathSize + 1 // The path plus the destination
+        switch destination {
+        case .snode: Metrics.beginSpan("onion_request.snode.\(hopCount)_hops")?.end(after: promise)
+        case .server: Metrics.beginSpan("onion_request.server.\(hopCount)_hops")?.end(after: promise)
+        }
         var guardSnode: Snode?
         Threading.workQueue.async { // Avoid race conditions on `guardSnodes` and `paths`
-            buildOnion(around: payload, targetedAt: destination).done2 { intermediate in
+            buildOnion(around: payload, targetedAt: destination, excludingGuardSnodes: excludedGuardSnodes).done2 { intermediate in
                 guardSnode = intermediate.guardSnode
+                onGuardSnodeSelected?(intermediate.guardSnode)
                 let url = "\(guardSnode!.address):\(guardSnode!.port)/onion_req/v2"
                 let finalEncryptionResult = intermediate.finalEncryptionResult
                 let onion = finalEncryptionResult.ciphertext
@@ -420,6 +460,7 @@ public enum OnionRequestAPI {
         }
         promise.catch2 { error in // Must be invoked on Threading.workQueue
             guard case HTTP.Error.httpRequestFailed(let statusCode, let json) = error, let guardSnode = guardSnode else { return }
+            Metrics.increment("onion_request.failures.\(statusCode)")
             let path = paths.first { $0.contains(guardSnode) }
             func handleUnspecificError() {
                 guard let path = path else { return }
@@ -9,6 +9,10 @@ public final class SnodeAPI : NSObject {
     private static var hasLoadedSnodePool = false
     private static var loadedSwarms: Set<String> = []
     private static var getSnodePoolPromise: Promise<Set<Snode>>?
+    /// The number of snodes the seed nodes returned when they were last queried, if they're overridden.
+    ///
+    /// - Note: Should only be accessed from `Threading.workQueue` to avoid race conditions.
+    private static var overriddenSnodePoolCount: Int?
     
     /// - Note: Should only be accessed from `Threading.workQueue` to avoid race conditions.
     internal static var snodeFailureCount: [Snode:UInt] = [:]
@@ -22,14 +26,27 @@ public final class SnodeAPI : NSObject {
     public static var clockOffset: Int64 = 0
     /// - Note: Should only be accessed from `Threading.workQueue` to avoid race conditions.
     public static var swarmCache: [String:Set<Snode>] = [:]
+    /// ONS name to the promise resolving it. Used to make concurrent lookups of the same name share a single set of requests.
+    ///
+    /// - Note: Should only be accessed from `Threading.workQueue` to avoid race conditions.
+    private static var onsResolutionPromises: [String:Promise<String>] = [:]
+    /// ONS name to the most recent failure to resolve it.
+    ///
+    /// - Note: Should only be accessed from `Threading.workQueue` to avoid race conditions.
+    private static var onsResolutionFailures: [String:(error: Swift.Error, date: Date)] = [:]
 
     // MARK: Settings
     private static let maxRetryCount: UInt = 8
     private static let minSwarmSnodeCount = 3
-    private static let seedNodePool: Set<String> = Features.useTestnet ? [ "http://public.loki.foundation:38157" ] : [ "https://storage.seed1.loki.network:4433", "https://storage.seed3.loki.network:4433", "https://public.loki.foundation:4433" ]
+    private static var seedNodePool: Set<String> { SNSnodeKitConfiguration.shared.seedNodePool ?? defaultSeedNodePool }
+    private static let defaultSeedNodePool: Set<String> = Features.useTestnet ? [ "http://public.loki.foundation:38157" ] : [ "https://storage.seed1.loki.network:4433", "https://storage.seed3.loki.network:4433", "https://public.loki.foundation:4433" ]
     private static let snodeFailureThreshold = 3
     private static let targetSwarmSnodeCount = 2
     private static let minSnodePoolCount = 12
+    /// ONS names can be transferred or renewed to point at a different Session ID, so successful resolutions are only trusted for a while.
+    private static let onsResolutionCacheTTL: TimeInterval = 24 * 60 * 60
+    /// Kept short so that a name that was just registered can be looked up again soon after.
+    private static let onsNegativeResolutionCacheTTL: TimeInterval = 60
     
     // MARK: Error
     public enum Error : LocalizedError {
@@ -68,12 +85,15 @@ public final class SnodeAPI : NSObject {
     // MARK: Snode Pool Interaction
     private static func loadSnodePoolIfNeeded() {
         guard !hasLoadedSnodePool else { return }
-        snodePool = SNSnodeKitConfiguration.shared.storage.getSnodePool()
+        if !SNSnodeKitConfiguration.shared.isSeedNodePoolOverridden {
+            snodePool = SNSnodeKitConfiguration.shared.storage.getSnodePool()
+        }
         hasLoadedSnodePool = true
     }
     
     private static func setSnodePool(to newValue: Set<Snode>, using transaction: Any? = nil) {
         snodePool = newValue
+        guard !SNSnodeKitConfiguration.shared.isSeedNodePoolOverridden else { return }
         let storage = SNSnodeKitConfiguration.shared.storage
         if let transaction = transaction {
             storage.setSnodePool(to: newValue, using: transaction)
@@ -103,7 +123,9 @@ public final class SnodeAPI : NSObject {
     // MARK: Swarm Interaction
     private static func loadSwarmIfNeeded(for publicKey: String) {
         guard !loadedSwarms.contains(publicKey) else { return }
-        swarmCache[publicKey] = SNSnodeKitConfiguration.shared.storage.getSwarm(for: publicKey)
+        if !SNSnodeKitConfiguration.shared.isSeedNodePoolOverridden {
+            swarmCache[publicKey] = SNSnodeKitConfiguration.shared.storage.getSwarm(for: publicKey)
+        }
         loadedSwarms.insert(publicKey)
     }
     
@@ -112,7 +134,7 @@ public final class SnodeAPI : NSObject {
         dispatchPrecondition(condition: .onQueue(Threading.workQueue))
         #endif
         swarmCache[publicKey] = newValue
-        guard persist else { return }
+        guard persist, !SNSnodeKitConfiguration.shared.isSeedNodePoolOverridden else { return }
         SNSnodeKitConfiguration.shared.storage.writeSync { transaction in
             SNSnodeKitConfiguration.shared.storage.setSwarm(to: newValue, for: publicKey, using: transaction)
         }
@@ -130,15 +152,19 @@ public final class SnodeAPI : NSObject {
     
     // MARK: Internal API
     internal static func invoke(_ method: Snode.Method, on snode: Snode, associatedWith publicKey: String? = nil, parameters: JSON) -> RawResponsePromise {
+        let span = Metrics.beginSpan("snode_api.\(method.rawValue)")
+        let promise: RawResponsePromise
         if Features.useOnionRequests {
-            return OnionRequestAPI.sendOnionRequest(to: snode, invoking: method, with: parameters, associatedWith: publicKey).map2 { $0 as Any }
+            promise = OnionRequestAPI.sendOnionRequest(to: snode, invoking: method, with: parameters, associatedWith: publicKey).map2 { $0 as Any }
         } else {
             let url = "\(snode.address):\(snode.port)/storage_rpc/v1"
-            return HTTP.execute(.post, url, parameters: parameters).map2 { $0 as Any }.recover2 { error -> Promise<Any> in
+            promise = HTTP.execute(.post, url, parameters: parameters).map2 { $0 as Any }.recover2 { error -> Promise<Any> in
                 guard case HTTP.Error.httpRequestFailed(let statusCode, let json) = error else { throw error }
                 throw SnodeAPI.handleError(withStatusCode: statusCode, json: json, forSnode: snode, associatedWith: publicKey) ?? error
             }
         }
+        span?.end(after: promise)
+        return promise
     }
     
     private static func getNetworkTime(from snode: Snode) -> Promise<UInt64> {
@@ -254,7 +280,12 @@ public final class SnodeAPI : NSObject {
     public static func getSnodePool() -> Promise<Set<Snode>> {
         loadSnodePoolIfNeeded()
         let now = Date()
-        let hasSnodePoolExpired = given(Storage.shared.getLastSnodePoolRefreshDate()) { now.timeIntervalSince($0) > 2 * 60 * 60 } ?? true
+        // An overridden network (e.g. a local one) is only ever queried through its seed nodes, and can be smaller than
+        // the real network
+        let isSeedNodePoolOverridden = SNSnodeKitConfiguration.shared.isSeedNodePoolOverridden
+        let minSnodePoolCount = isSeedNodePoolOverridden ? min(SnodeAPI.minSnodePoolCount, max(overriddenSnodePoolCount ?? 1, 1)) : SnodeAPI.minSnodePoolCount
+        let hasSnodePoolExpired = !isSeedNodePoolOverridden
+            && (given(Storage.shared.getLastSnodePoolRefreshDate()) { now.timeIntervalSince($0) > 2 * 60 * 60 } ?? true)
         let snodePool = SnodeAPI.snodePool
         let hasInsufficientSnodes = (snodePool.count < minSnodePoolCount)
         if hasInsufficientSnodes || hasSnodePoolExpired {
@@ -277,8 +308,13 @@ public final class SnodeAPI : NSObject {
             }
             promise.then2 { snodePool -> Promise<Set<Snode>> in
                 let (promise, seal) = Promise<Set<Snode>>.pending()
+                if isSeedNodePoolOverridden {
+                    overriddenSnodePoolCount = snodePool.count
+                }
                 SNSnodeKitConfiguration.shared.storage.write(with: { transaction in
-                    Storage.shared.setLastSnodePoolRefreshDate(to: now, using: transaction)
+                    if !isSeedNodePoolOverridden {
+                        Storage.shared.setLastSnodePoolRefreshDate(to: now, using: transaction)
+                    }
                     setSnodePool(to: snodePool, using: transaction)
                 }, completion: {
                     seal.fulfill(snodePool)
@@ -298,10 +334,46 @@ public final class SnodeAPI : NSObject {
     }
     
     public static func getSessionID(for onsName: String) -> Promise<String> {
-        let validationCount = 3
-        let sessionIDByteCount = 33
         // The name must be lowercased
         let onsName = onsName.lowercased()
+        if let resolution = SNSnodeKitConfiguration.shared.storage.getSessionID(forONSName: onsName),
+            Date().timeIntervalSince(resolution.date) < onsResolutionCacheTTL {
+            return Promise.value(resolution.sessionID)
+        }
+        let (promise, seal) = Promise<String>.pending()
+        Threading.workQueue.async { // Avoid race conditions on `onsResolutionPromises` and `onsResolutionFailures`
+            if let failure = onsResolutionFailures[onsName], Date().timeIntervalSince(failure.date) < onsNegativeResolutionCacheTTL {
+                return seal.reject(failure.error)
+            }
+            if let resolutionPromise = onsResolutionPromises[onsName] {
+                return resolutionPromise.pipe(to: seal.resolve)
+            }
+            let resolutionPromise = resolve(onsName)
+            onsResolutionPromises[onsName] = resolutionPromise
+            resolutionPromise.done2 { sessionID in
+                onsResolutionPromises[onsName] = nil
+                onsResolutionFailures[onsName] = nil
+                SNSnodeKitConfiguration.shared.storage.write { transaction in
+                    SNSnodeKitConfiguration.shared.storage.setSessionID(sessionID, forONSName: onsName, using: transaction)
+                }
+            }.catch2 { error in
+                onsResolutionPromises[onsName] = nil
+                // Only remember failures that came from the snodes' answers: the name not being found (no encrypted
+                // value in the response), a value that couldn't be decrypted, or snodes disagreeing. Local failures (e.g.
+                // an unusable snode pool or a network error) shouldn't block retrying a valid name.
+                switch error {
+                case SnodeAPI.Error.validationFailed, SnodeAPI.Error.decryptionFailed, HTTP.Error.invalidJSON:
+                    onsResolutionFailures[onsName] = (error: error, date: Date())
+                default: break
+                }
+            }
+            resolutionPromise.pipe(to: seal.resolve)
+        }
+        return promise
+    }
+
+    private static func resolve(_ onsName: String) -> Promise<String> {
+        let validationCount = 3
         // Hash the ONS name using BLAKE2b
         let nameAsData = [UInt8](onsName.data(using: String.Encoding.utf8)!)
         guard let nameHash = sodium.genericHash.hash(message: nameAsData),
@@ -323,47 +395,60 @@ public final class SnodeAPI : NSObject {
         }
         let (promise, seal) = Promise<String>.pending()
         when(resolved: promises).done2 { results in
-            var sessionIDs: [String] = []
+            // Decryption is expensive (especially the old Argon2-based scheme), and in practice all snodes return the
+            // same ciphertext, so we only decrypt each distinct response once
+            var sessionIDsByResponse: [String:String] = [:]
             for result in results {
                 switch result {
                 case .rejected(let error): return seal.reject(error)
                 case .fulfilled(let rawResponse):
                     guard let json = rawResponse as? JSON, let intermediate = json["result"] as? JSON,
                         let hexEncodedCiphertext = intermediate["encrypted_value"] as? String else { return seal.reject(HTTP.Error.invalidJSON) }
-                    let ciphertext = [UInt8](Data(hex: hexEncodedCiphertext))
-                    let isArgon2Based = (intermediate["nonce"] == nil)
-                    if isArgon2Based {
-                        // Handle old Argon2-based encryption used before HF16
-                        let salt = [UInt8](Data(repeating: 0, count: sodium.pwHash.SaltBytes))
-                        guard let key = sodium.pwHash.hash(outputLength: sodium.secretBox.KeyBytes, passwd: nameAsData, salt: salt,
-                            opsLimit: sodium.pwHash.OpsLimitModerate, memLimit: sodium.pwHash.MemLimitModerate, alg: .Argon2ID13) else { return seal.reject(Error.hashingFailed) }
-                        let nonce = [UInt8](Data(repeating: 0, count: sodium.secretBox.NonceBytes))
-                        guard let sessionIDAsData = sodium.secretBox.open(authenticatedCipherText: ciphertext, secretKey: key, nonce: nonce) else {
-                            return seal.reject(Error.decryptionFailed)
-                        }
-                        sessionIDs.append(sessionIDAsData.toHexString())
-                    } else {
-                        guard let hexEncodedNonce = intermediate["nonce"] as? String else { return seal.reject(HTTP.Error.invalidJSON) }
-                        let nonce = [UInt8](Data(hex: hexEncodedNonce))
-                        // xchacha-based encryption
-                        guard let key = sodium.genericHash.hash(message: nameAsData, key: nameHash) else { // key = H(name, key=H(name))
-                            return seal.reject(Error.hashingFailed)
-                        }
-                        guard ciphertext.count >= (sessionIDByteCount + sodium.aead.xchacha20poly1305ietf.ABytes) else { // Should always be equal in practice
-                            return seal.reject(Error.decryptionFailed)
-                        }
-                        guard let sessionIDAsData = sodium.aead.xchacha20poly1305ietf.decrypt(authenticatedCipherText: ciphertext, secretKey: key, nonce: nonce) else {
-                            return seal.reject(Error.decryptionFailed)
-                        }
-                        sessionIDs.append(sessionIDAsData.toHexString())
+                    let hexEncodedNonce = intermediate["nonce"] as? String
+                    let responseKey = "\(hexEncodedCiphertext).\(hexEncodedNonce ?? "")"
+                    guard sessionIDsByResponse[responseKey] == nil else { continue }
+                    do {
+                        sessionIDsByResponse[responseKey] = try decryptONSResponse(ciphertext: [UInt8](Data(hex: hexEncodedCiphertext)),
+                            hexEncodedNonce: hexEncodedNonce, nameAsData: nameAsData, nameHash: nameHash)
+                    } catch {
+                        return seal.reject(error)
                     }
                 }
             }
-            guard sessionIDs.count == validationCount && Set(sessionIDs).count == 1 else { return seal.reject(Error.validationFailed) }
+            let sessionIDs = Set(sessionIDsByResponse.values)
+            guard sessionIDs.count == 1 else { return seal.reject(Error.validationFailed) }
             seal.fulfill(sessionIDs.first!)
         }
         return promise
     }
+
+    private static func decryptONSResponse(ciphertext: [UInt8], hexEncodedNonce: String?, nameAsData: [UInt8], nameHash: [UInt8]) throws -> String {
+        let sessionIDByteCount = 33
+        if let hexEncodedNonce = hexEncodedNonce {
+            let nonce = [UInt8](Data(hex: hexEncodedNonce))
+            // xchacha-based encryption
+            guard let key = sodium.genericHash.hash(message: nameAsData, key: nameHash) else { // key = H(name, key=H(name))
+                throw Error.hashingFailed
+            }
+            guard ciphertext.count >= (sessionIDByteCount + sodium.aead.xchacha20poly1305ietf.ABytes) else { // Should always be equal in practice
+                throw Error.decryptionFailed
+            }
+            guard let sessionIDAsData = sodium.aead.xchacha20poly1305ietf.decrypt(authenticatedCipherText: ciphertext, secretKey: key, nonce: nonce) else {
+                throw Error.decryptionFailed
+            }
+            return sessionIDAsData.toHexString()
+        } else {
+            // Handle old Argon2-based encryption used before HF16
+            let salt = [UInt8](Data(repeating: 0, count: sodium.pwHash.SaltBytes))
+            guard let key = sodium.pwHash.hash(outputLength: sodium.secretBox.KeyBytes, passwd: nameAsData, salt: salt,
+                opsLimit: sodium.pwHash.OpsLimitModerate, memLimit: sodium.pwHash.MemLimitModerate, alg: .Argon2ID13) else { throw Error.hashingFailed }
+            let nonce = [UInt8](Data(repeating: 0, count: sodium.secretBox.NonceBytes))
+            guard let sessionIDAsData = sodium.secretBox.open(authenticatedCipherText: ciphertext, secretKey: key, nonce: nonce) else {
+                throw Error.decryptionFailed
+            }
+            return sessionIDAsData.toHexString()
+        }
+    }
     
     public static func getTargetSnodes(for publicKey: String) -> Promise<[Snode]> {
         // shuffled() uses the system's default random generator, which is cryptographically secure
@@ -617,6 +702,7 @@ public final class SnodeAPI : NSObject {
         #if DEBUG
         dispatchPrecondition(condition: .onQueue(Threading.workQueue))
         #endif
+        Metrics.increment("snode_api.errors.\(statusCode)")
         func handleBadSnode() {
             let oldFailureCount = SnodeAPI.snodeFailureCount[snode] ?? 0
             let newFailureCount = oldFailureCount + 1
@@ -136,4 +136,25 @@ extension Storage {
     public func setReceivedMessages(to receivedMessages: Set<String>, for publicKey: String, using transaction: Any) {
         (transaction as! YapDatabaseReadWriteTransaction).setObject(receivedMessages, forKey: publicKey, inCollection: Storage.receivedMessagesCollection)
     }
+
+
+
+    // MARK: - ONS
+
+    private static let onsResolutionCollection = "SNONSResolutionCollection"
+
+    /// Returns the Session ID the given ONS name last resolved to, along with the date on which it was resolved.
+    public func getSessionID(forONSName onsName: String) -> (sessionID: String, date: Date)? {
+        var result: JSON?
+        Storage.read { transaction in
+            result = transaction.object(forKey: onsName, inCollection: Storage.onsResolutionCollection) as? JSON
+        }
+        guard let sessionID = result?["sessionID"] as? String, let date = result?["date"] as? Date else { return nil }
+        return (sessionID: sessionID, date: date)
+    }
+
+    public func setSessionID(_ sessionID: String, forONSName onsName: String, using transaction: Any) {
+        let resolution: JSON = [ "sessionID" : sessionID, "date" : Date() ]
+        (transaction as! YapDatabaseReadWriteTransaction).setObject(resolution, forKey: onsName, inCollection: Storage.onsResolutionCollection)
+    }
 }
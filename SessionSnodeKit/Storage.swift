@@ -25,4 +25,6 @@ public protocol SessionSnodeKitStorageProtocol {
     func pruneLastMessageHashInfoIfExpired(for snode: Snode, associatedWith publicKey: String)
     func getReceivedMessages(for publicKey: String) -> Set<String>
     func setReceivedMessages(to receivedMessages: Set<String>, for publicKey: String, using transaction: Any)
+    func getSessionID(forONSName onsName: String) -> (sessionID: String, date: Date)?
+    func setSessionID(_ sessionID: String, forONSName onsName: String, using transaction: Any)
 }
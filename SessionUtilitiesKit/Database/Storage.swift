@@ -8,7 +8,12 @@ import YapDatabase
 
 @objc(LKStorage)
 public final class Storage : NSObject {
-    public static let serialQueue = DispatchQueue(label: "Storage.serialQueue", qos: .userInitiated)
+    public static let serialQueue: DispatchQueue = {
+        let result = DispatchQueue(label: "Storage.serialQueue", qos: .userInitiated)
+        result.setSpecific(key: serialQueueKey, value: ())
+        return result
+    }()
+    private static let serialQueueKey = DispatchSpecificKey<Void>()
 
     private static var owsStorage: OWSPrimaryStorageProtocol { SNUtilitiesKitConfiguration.shared.owsPrimaryStorage }
     
@@ -26,6 +31,29 @@ public final class Storage : NSObject {
         owsStorage.dbReadConnection.read(block)
     }
 
+    /// Reads from the database after the writes that the calling thread has scheduled using `write(with:)` have been committed.
+    ///
+    /// Reads using `read(with:)` go through a pool of read-only connections so that they don't have to wait for writes,
+    /// which means they can't see the effects of writes that are still pending. Only use this for the few call sites that
+    /// need to. It only waits for the calling thread's own writes, not for every pending write, and when called from within
+    /// a write scheduled using `write(with:)` it reads using that write's transaction instead of waiting.
+    @objc(readYourWritesWithBlock:)
+    public static func readYourWrites(with block: @escaping (YapDatabaseReadTransaction) -> Void) {
+        let threadDictionary = Thread.current.threadDictionary
+        if let transaction = threadDictionary[currentWriteTransactionKey] as? YapDatabaseReadWriteTransaction {
+            return block(transaction)
+        }
+        // Waiting on `serialQueue` would deadlock; any writes this thread scheduled are committed after it returns anyway
+        if DispatchQueue.getSpecific(key: serialQueueKey) == nil,
+            let sequenceNumber = (threadDictionary[lastScheduledWriteKey] as? NSNumber)?.uint64Value {
+            commitCondition.lock()
+            while committedSequenceNumber < sequenceNumber { commitCondition.wait() }
+            commitCondition.unlock()
+        }
+        // New read transactions start from the most recent commit, so any connection will do
+        read(with: block)
+    }
+
     // MARK: Writing
 
     // Some important points regarding writing to the database:
@@ -53,14 +81,73 @@ public final class Storage : NSObject {
     @discardableResult
     public static func write(with block: @escaping (YapDatabaseReadWriteTransaction) -> Void, completion: @escaping () -> Void) -> Promise<Void> {
         let (promise, seal) = Promise<Void>.pending()
+        pendingWritesLock.lock()
+        let sequenceNumber = nextSequenceNumber
+        nextSequenceNumber += 1
+        pendingWrites.append(PendingWrite(block: block, completion: completion, seal: seal, sequenceNumber: sequenceNumber))
+        pendingWritesLock.unlock()
+        Thread.current.threadDictionary[lastScheduledWriteKey] = NSNumber(value: sequenceNumber)
         serialQueue.async {
+            commitPendingWrites()
+        }
+        return promise
+    }
+
+    // MARK: Group Commit
+
+    // Every write transaction pays for the transaction setup, the extension hooks, a WAL sync and a cross-process
+    // notification. When writes are scheduled faster than they can be committed (e.g. while processing a large
+    // batch of received messages), the writes that have piled up by the time a transaction starts are therefore
+    // executed together in a single transaction, in the order in which they were scheduled. This doesn't delay
+    // writes when the database is idle.
+
+    private struct PendingWrite {
+        let block: (YapDatabaseReadWriteTransaction) -> Void
+        let completion: () -> Void
+        let seal: Resolver<Void>
+        let sequenceNumber: UInt64
+    }
+
+    /// The maximum number of writes that are executed in a single transaction, so that one transaction doesn't hold
+    /// the write lock for too long.
+    public static let maxGroupCommitSize = 32
+    private static var pendingWrites: [PendingWrite] = []
+    /// Should only be accessed while holding `pendingWritesLock`.
+    private static var nextSequenceNumber: UInt64 = 1
+    private static let pendingWritesLock = NSLock()
+    /// The sequence number of the last write that was committed. Should only be accessed while holding `commitCondition`.
+    private static var committedSequenceNumber: UInt64 = 0
+    private static let commitCondition = NSCondition()
+    /// Thread dictionary keys used by `readYourWrites(with:)`.
+    private static let lastScheduledWriteKey = "Storage.lastScheduledWriteSequenceNumber"
+    private static let currentWriteTransactionKey = "Storage.currentWriteTransaction"
+
+    /// Must be called on `serialQueue`.
+    private static func commitPendingWrites() {
+        pendingWritesLock.lock()
+        let writes = Array(pendingWrites.prefix(maxGroupCommitSize))
+        pendingWrites.removeFirst(writes.count)
+        pendingWritesLock.unlock()
+        // Every write schedules a call to this function, so if earlier calls picked up this call's write there's
+        // nothing left to do
+        guard !writes.isEmpty else { return }
+        Metrics.record("storage.group_commit_size", value: UInt64(writes.count))
+        Metrics.measure("storage.write_transaction") { // Roughly the time the write lock is held for
             owsStorage.dbReadWriteConnection.readWrite { transaction in
-                transaction.addCompletionQueue(DispatchQueue.main, completionBlock: completion)
-                block(transaction)
+                let threadDictionary = Thread.current.threadDictionary
+                threadDictionary[currentWriteTransactionKey] = transaction
+                for write in writes {
+                    transaction.addCompletionQueue(DispatchQueue.main, completionBlock: write.completion)
+                    write.block(transaction)
+                }
+                threadDictionary[currentWriteTransactionKey] = nil
             }
-            seal.fulfill(())
         }
-        return promise
+        commitCondition.lock()
+        committedSequenceNumber = writes.last!.sequenceNumber
+        commitCondition.broadcast()
+        commitCondition.unlock()
+        writes.forEach { $0.seal.fulfill(()) }
     }
 
     /// Blocks the calling thread until the write has finished.
@@ -103,12 +103,11 @@ NS_ASSUME_NONNULL_BEGIN
 
 + (YapDatabaseConnection *)dbReadConnection
 {
-    // We use TSYapDatabaseObject's dbReadWriteConnection (not OWSPrimaryStorage's
-    // dbReadConnection) for consistency, since we tend to [TSYapDatabaseObject
-    // save] and want to write to the same connection we read from.  To get true
-    // consistency, we'd want to update entities by reading & writing from within
-    // the same transaction, but that'll be a big refactor.
-    return self.dbReadWriteConnection;
+    // Reads go through OWSPrimaryStorage's pool of read connections so that they don't queue up behind
+    // (potentially long) write transactions. Synchronous saves have been committed by the time they return,
+    // so they're visible to subsequent reads. Callers that need to see the effects of pending async writes
+    // should use -reload or +[LKStorage readYourWritesWithBlock:].
+    return SNUtilitiesKitConfiguration.shared.owsPrimaryStorage.dbReadConnection;
 }
 
 + (YapDatabaseConnection *)dbReadWriteConnection
@@ -204,7 +203,7 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (void)reload
 {
-    [self.dbReadConnection readWithBlock:^(YapDatabaseReadTransaction *_Nonnull transaction) {
+    [LKStorage readYourWritesWithBlock:^(YapDatabaseReadTransaction *_Nonnull transaction) {
         [self reloadWithTransaction:transaction];
     }];
 }
@@ -92,6 +92,13 @@ public class LRUCache<KeyType: Hashable & Equatable, ValueType> {
         }
     }
 
+    public func remove(key: KeyType) {
+        guard cacheMap.removeValue(forKey: key) != nil else {
+            return
+        }
+        cacheOrder = cacheOrder.filter { $0 != key }
+    }
+
     @objc
     public func clear() {
         cacheMap.removeAll()
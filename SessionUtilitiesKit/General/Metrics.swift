@@ -0,0 +1,240 @@
+import Foundation
+import PromiseKit
+
+/// Lightweight client instrumentation: counters, latency histograms and trace spans, which can be exported locally as
+/// JSON or in the Chrome trace event format (viewable in `chrome://tracing` or Perfetto).
+///
+/// Recording is off by default, in which case every call returns after a single check of `isEnabled`. Names are taken as
+/// autoclosures, so interpolating them doesn't cost anything either. When enabled, each recording takes a short-lived
+/// `os_unfair_lock` and only allocates for span objects and the first time a name is seen.
+public enum Metrics {
+    private static var lock = os_unfair_lock()
+    private static var counters: [String:Int64] = [:]
+    private static var histograms: [String:Histogram] = [:]
+    private static var spans: [SpanRecord] = []
+    private static var nextSpanIndex = 0
+    private static var nextSpanID: UInt64 = 1
+
+    // MARK: Settings
+    /// Should be set before any instrumented code runs (e.g. during app launch).
+    public static var isEnabled = false
+    /// The number of most recent finished spans kept around for the trace export.
+    public static let maxSpanCount = 10_000
+
+    // MARK: Counters
+    public static func increment(_ name: @autoclosure () -> String, by value: Int64 = 1) {
+        guard isEnabled else { return }
+        os_unfair_lock_lock(&lock)
+        counters[name(), default: 0] += value
+        os_unfair_lock_unlock(&lock)
+    }
+
+    // MARK: Histograms
+    /// Records a value, e.g. a size or count, in the histogram with the given name.
+    public static func record(_ name: @autoclosure () -> String, value: UInt64) {
+        guard isEnabled else { return }
+        os_unfair_lock_lock(&lock)
+        histograms[name(), default: Histogram()].record(value)
+        os_unfair_lock_unlock(&lock)
+    }
+
+    /// Records a duration in the histogram with the given name. Durations are stored in microseconds.
+    public static func record(_ name: @autoclosure () -> String, duration: TimeInterval) {
+        guard isEnabled else { return }
+        record(name(), value: UInt64(max(duration, 0) * 1_000_000))
+    }
+
+    // MARK: Spans
+    /// Starts a span, which records its duration in the histogram with the same name when it ends. Pass `parent` to nest
+    /// the span under another one; this also works when the child runs on a different thread or queue.
+    ///
+    /// Returns `nil` if recording is disabled, so the result can be used with optional chaining without any overhead.
+    public static func beginSpan(_ name: @autoclosure () -> String, parent: Span? = nil) -> Span? {
+        guard isEnabled else { return nil }
+        os_unfair_lock_lock(&lock)
+        let id = nextSpanID
+        nextSpanID += 1
+        os_unfair_lock_unlock(&lock)
+        return Span(name: name(), id: id, traceID: parent?.traceID ?? id, startTime: DispatchTime.now().uptimeNanoseconds)
+    }
+
+    public static func measure<T>(_ name: @autoclosure () -> String, parent: Span? = nil, _ block: () throws -> T) rethrows -> T {
+        let span = beginSpan(name(), parent: parent)
+        defer { span?.end() }
+        return try block()
+    }
+
+    /// Measures the time until the promise returned by `block` resolves.
+    public static func measure<T>(_ name: @autoclosure () -> String, parent: Span? = nil, _ block: () -> Promise<T>) -> Promise<T> {
+        let span = beginSpan(name(), parent: parent)
+        let promise = block()
+        span?.end(after: promise)
+        return promise
+    }
+
+    public final class Span {
+        public let name: String
+        fileprivate let id: UInt64
+        fileprivate let traceID: UInt64
+        fileprivate let startTime: UInt64
+        private var hasEnded = false
+
+        fileprivate init(name: String, id: UInt64, traceID: UInt64, startTime: UInt64) {
+            self.name = name
+            self.id = id
+            self.traceID = traceID
+            self.startTime = startTime
+        }
+
+        /// Ends the span once the given promise resolves.
+        public func end<T>(after promise: Promise<T>) {
+            promise.pipe { _ in self.end() } // Runs synchronously, which avoids an extra dispatch per span
+        }
+
+        /// Ending a span more than once has no effect.
+        public func end() {
+            let endTime = DispatchTime.now().uptimeNanoseconds
+            os_unfair_lock_lock(&Metrics.lock)
+            defer { os_unfair_lock_unlock(&Metrics.lock) }
+            guard !hasEnded else { return }
+            hasEnded = true
+            let record = SpanRecord(name: name, id: id, traceID: traceID, startTime: startTime, endTime: endTime)
+            Metrics.histograms[name, default: Histogram()].record((endTime - startTime) / 1000)
+            if Metrics.spans.count < Metrics.maxSpanCount {
+                Metrics.spans.append(record)
+            } else {
+                Metrics.spans[Metrics.nextSpanIndex] = record
+            }
+            Metrics.nextSpanIndex = (Metrics.nextSpanIndex + 1) % Metrics.maxSpanCount
+        }
+    }
+
+    fileprivate struct SpanRecord {
+        let name: String
+        let id: UInt64
+        let traceID: UInt64
+        let startTime: UInt64
+        let endTime: UInt64
+    }
+
+    // MARK: Exporting
+    /// Returns the counters along with the count, min, max and p50/p90/p99 of every histogram.
+    public static func exportJSON() -> JSON {
+        os_unfair_lock_lock(&lock)
+        let counters = self.counters
+        let histograms = self.histograms
+        os_unfair_lock_unlock(&lock)
+        return [
+            "counters" : counters,
+            "histograms" : histograms.mapValues { histogram -> JSON in
+                return [
+                    "count" : histogram.count,
+                    "min" : histogram.min,
+                    "max" : histogram.max,
+                    "p50" : histogram.percentile(50),
+                    "p90" : histogram.percentile(90),
+                    "p99" : histogram.percentile(99)
+                ]
+            }
+        ]
+    }
+
+    /// Returns the most recent spans in the Chrome trace event format. Spans are exported as async events, so nested
+    /// spans are shown under their parent even if they ran on different threads.
+    public static func exportChromeTrace() -> Data {
+        os_unfair_lock_lock(&lock)
+        let spans = self.spans
+        os_unfair_lock_unlock(&lock)
+        var events: [JSON] = []
+        events.reserveCapacity(2 * spans.count)
+        for span in spans {
+            let common: JSON = [ "name" : span.name, "cat" : "session", "id" : String(span.traceID), "pid" : 0, "tid" : 0 ]
+            events.append(common.merging([ "ph" : "b", "ts" : span.startTime / 1000 ]) { $1 })
+            events.append(common.merging([ "ph" : "e", "ts" : span.endTime / 1000 ]) { $1 })
+        }
+        let trace: JSON = [ "traceEvents" : events, "displayTimeUnit" : "ms" ]
+        return (try? JSONSerialization.data(withJSONObject: trace, options: [])) ?? Data()
+    }
+
+    /// Writes `metrics.json` and `trace.json` to the given directory.
+    public static func export(to directory: URL) throws {
+        let json = try JSONSerialization.data(withJSONObject: exportJSON(), options: [ .prettyPrinted ])
+        try json.write(to: directory.appendingPathComponent("metrics.json"), options: [ .atomic ])
+        try exportChromeTrace().write(to: directory.appendingPathComponent("trace.json"), options: [ .atomic ])
+    }
+
+    public static func reset() {
+        os_unfair_lock_lock(&lock)
+        counters.removeAll()
+        histograms.removeAll()
+        spans.removeAll()
+        nextSpanIndex = 0
+        os_unfair_lock_unlock(&lock)
+    }
+}
+
+// MARK: Objective-C
+@objc(SNMetrics)
+public final class ObjCMetrics : NSObject {
+
+    override private init() { }
+
+    @objc public static var isEnabled: Bool { return Metrics.isEnabled }
+
+    @objc(incrementCounterWithName:)
+    public static func increment(name: String) {
+        Metrics.increment(name)
+    }
+
+    @objc(recordValue:withName:)
+    public static func record(_ value: UInt64, name: String) {
+        Metrics.record(name, value: value)
+    }
+}
+
+// MARK: Histogram
+/// A log-linear histogram in the style of HdrHistogram: every power of two range is split into 8 linear sub-buckets, so
+/// recorded values are accurate to within 12.5% using a fixed 496 buckets, regardless of the range of values.
+fileprivate struct Histogram {
+    private static let subBucketBits: UInt64 = 3
+    private static let subBucketCount = 1 << subBucketBits
+    private static let bucketCount = (64 - Int(subBucketBits) + 1) * subBucketCount
+
+    private var counts = [UInt64](repeating: 0, count: Histogram.bucketCount)
+    private(set) var count: UInt64 = 0
+    private(set) var min = UInt64.max
+    private(set) var max: UInt64 = 0
+
+    mutating func record(_ value: UInt64) {
+        counts[Histogram.index(for: value)] += 1
+        count += 1
+        min = Swift.min(min, value)
+        max = Swift.max(max, value)
+    }
+
+    /// Returns the lower bound of the bucket containing the given percentile, clamped to the recorded range.
+    func percentile(_ percentile: Double) -> UInt64 {
+        guard count > 0 else { return 0 }
+        let target = Swift.max(1, UInt64((percentile / 100 * Double(count)).rounded(.up)))
+        var total: UInt64 = 0
+        for (index, bucketCount) in counts.enumerated() where bucketCount > 0 {
+            total += bucketCount
+            if total >= target { return Swift.min(Swift.max(Histogram.value(for: index), min), max) }
+        }
+        return max
+    }
+
+    private static func index(for value: UInt64) -> Int {
+        guard value >= UInt64(subBucketCount) else { return Int(value) }
+        let magnitude = UInt64(63 - value.leadingZeroBitCount)
+        let subBucket = Int((value >> (magnitude - subBucketBits)) & UInt64(subBucketCount - 1))
+        return Int(magnitude - subBucketBits + 1) * subBucketCount + subBucket
+    }
+
+    private static func value(for index: Int) -> UInt64 {
+        guard index >= subBucketCount else { return UInt64(index) }
+        let magnitude = UInt64(index / subBucketCount) + subBucketBits - 1
+        let subBucket = UInt64(index % subBucketCount)
+        return (UInt64(subBucketCount) + subBucket) << (magnitude - subBucketBits)
+    }
+}
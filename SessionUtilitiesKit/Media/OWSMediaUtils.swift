@@ -116,6 +116,10 @@ public enum OWSMediaError: Error {
     public static var kMaxFileSizeImage: UInt { SNUtilitiesKitConfiguration.shared.maxFileSize }
     @objc
     public static var kMaxFileSizeVideo: UInt { SNUtilitiesKitConfiguration.shared.maxFileSize }
+    /// The largest video that still fits within `kMaxFileSizeVideo` once it's been encrypted for upload, which is the size
+    /// that's checked against the limit. Used as the budget for transcoded videos.
+    @objc
+    public static var kMaxFileSizeVideoBeforeEncryption: UInt { maxByteCountBeforeEncryption(forMaxByteCount: kMaxFileSizeVideo) }
     @objc
     public static var kMaxFileSizeAudio: UInt { SNUtilitiesKitConfiguration.shared.maxFileSize }
     @objc
@@ -123,6 +127,14 @@ public enum OWSMediaError: Error {
 
     @objc
     public static let kMaxVideoDimensions: CGFloat = 3 * 1024
+
+    /// Attachments are padded to the next power of 1.05 (i.e. by up to 5%) before they're encrypted, and then gain an IV,
+    /// up to a block of PKCS7 padding and a MAC.
+    private static func maxByteCountBeforeEncryption(forMaxByteCount maxByteCount: UInt) -> UInt {
+        let encryptionOverhead: UInt = 16 + 16 + 32
+        guard maxByteCount > encryptionOverhead + 1 else { return 0 }
+        return UInt((Double(maxByteCount - encryptionOverhead - 1) / 1.05).rounded(.down))
+    }
     @objc
     public static let kMaxAnimatedImageDimensions: UInt = 1 * 1024
     @objc
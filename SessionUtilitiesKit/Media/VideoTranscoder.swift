@@ -0,0 +1,355 @@
+import AVFoundation
+import PromiseKit
+
+public enum VideoTranscodeError : LocalizedError {
+    case noVideoTrack
+    /// The video is too long to fit within the byte budget at an acceptable quality.
+    case exceedsByteBudget
+    case cancelled
+    case failed(Error?)
+
+    public var errorDescription: String? {
+        switch self {
+        case .noVideoTrack: return "The video doesn't have a video track."
+        case .exceedsByteBudget: return "The video is too large."
+        case .cancelled: return "Transcoding was cancelled."
+        case .failed(let error): return "Transcoding failed due to error: \(error?.localizedDescription ?? "unknown")."
+        }
+    }
+}
+
+// MARK: Plan
+/// The output settings for a transcode, derived from the clip's duration and the byte budget. Rather than using a fixed
+/// preset, the bit rate is set so that the output uses (most of) the budget, and the resolution and then the frame rate are
+/// lowered only when the bit rate would otherwise be too low for them.
+public struct VideoTranscodePlan {
+    /// In the video track's natural (i.e. unrotated) orientation.
+    public let size: CGSize
+    public let frameRate: Float
+    public let videoBitRate: Int
+    /// Zero if the output doesn't have an audio track.
+    public let audioBitRate: Int
+    public let audioChannelCount: Int
+
+    // MARK: Settings
+    /// The fraction of the byte budget the planned bit rates add up to. The rest is left for container overhead and encoder
+    /// overshoot.
+    public static let budgetUtilization: Double = 0.9
+    /// Output sizes to try, by longest edge.
+    public static let resolutionLadder: [CGFloat] = [ 1920, 1280, 960, 640, 480, 320 ]
+    public static let maxFrameRate: Float = 30
+    /// Frame rates to fall back on at the lowest resolution.
+    public static let reducedFrameRates: [Float] = [ 24, 15 ]
+    /// Below this H.264 output gets visibly blocky, so a lower resolution is used instead.
+    public static let minBitsPerPixel: Double = 0.05
+    /// Above this there's no visible improvement, so short clips don't use their whole budget.
+    public static let maxBitsPerPixel: Double = 0.2
+    public static let minVideoBitRate = 100_000
+    public static let audioBitRate = 128_000
+    /// Used when the total bit rate is below `lowBitRateThreshold`.
+    public static let lowAudioBitRate = 64_000
+    public static let lowBitRateThreshold: Double = 1_000_000
+    public static let audioSampleRate = 44_100
+
+    public init(size: CGSize, frameRate: Float, videoBitRate: Int, audioBitRate: Int, audioChannelCount: Int) {
+        self.size = size
+        self.frameRate = frameRate
+        self.videoBitRate = videoBitRate
+        self.audioBitRate = audioBitRate
+        self.audioChannelCount = audioChannelCount
+    }
+
+    /// Throws `VideoTranscodeError.exceedsByteBudget` if the clip can't fit within `maxByteCount` at the minimum video bit rate,
+    /// so that it can be rejected without transcoding it first.
+    public init(duration: TimeInterval, sourceSize: CGSize, sourceFrameRate: Float, sourceAudioChannelCount: Int, maxByteCount: UInt) throws {
+        let duration = max(duration, 1)
+        let totalBitRate = Double(maxByteCount) * 8 * VideoTranscodePlan.budgetUtilization / duration
+        let audioBitRate: Int
+        if sourceAudioChannelCount > 0 {
+            audioBitRate = (totalBitRate < VideoTranscodePlan.lowBitRateThreshold) ? VideoTranscodePlan.lowAudioBitRate : VideoTranscodePlan.audioBitRate
+        } else {
+            audioBitRate = 0
+        }
+        let maxVideoBitRate = totalBitRate - Double(audioBitRate)
+        guard maxVideoBitRate >= Double(VideoTranscodePlan.minVideoBitRate) else { throw VideoTranscodeError.exceedsByteBudget }
+        // Pick the largest size (and then the highest frame rate) that gets enough bits per pixel
+        let sourceLongestEdge = max(sourceSize.width, sourceSize.height)
+        let maxLongestEdge = min(sourceLongestEdge, VideoTranscodePlan.resolutionLadder[0])
+        let longestEdges = [ maxLongestEdge ] + VideoTranscodePlan.resolutionLadder.filter { $0 < maxLongestEdge }
+        let initialFrameRate = (sourceFrameRate > 0) ? min(sourceFrameRate, VideoTranscodePlan.maxFrameRate) : VideoTranscodePlan.maxFrameRate
+        var candidates = longestEdges.map { (size: VideoTranscodePlan.size(scaling: sourceSize, toLongestEdge: $0), frameRate: initialFrameRate) }
+        let smallestSize = candidates.last!.size
+        candidates += VideoTranscodePlan.reducedFrameRates.filter { $0 < initialFrameRate }.map { (size: smallestSize, frameRate: $0) }
+        let candidate = candidates.first { candidate in
+            let pixelRate = Double(candidate.size.width * candidate.size.height) * Double(candidate.frameRate)
+            return maxVideoBitRate / pixelRate >= VideoTranscodePlan.minBitsPerPixel
+        } ?? candidates.last!
+        let pixelRate = Double(candidate.size.width * candidate.size.height) * Double(candidate.frameRate)
+        let videoBitRate = min(maxVideoBitRate, pixelRate * VideoTranscodePlan.maxBitsPerPixel)
+        self.init(size: candidate.size, frameRate: candidate.frameRate, videoBitRate: Int(videoBitRate),
+            audioBitRate: audioBitRate, audioChannelCount: min(sourceAudioChannelCount, 2))
+    }
+
+    public init(for asset: AVAsset, maxByteCount: UInt) throws {
+        guard let videoTrack = asset.tracks(withMediaType: .video).first else { throw VideoTranscodeError.noVideoTrack }
+        var audioChannelCount = 0
+        if let audioTrack = asset.tracks(withMediaType: .audio).first {
+            let formatDescription = audioTrack.formatDescriptions.first.map { $0 as! CMAudioFormatDescription }
+            let streamDescription = formatDescription.flatMap { CMAudioFormatDescriptionGetStreamBasicDescription($0)?.pointee }
+            audioChannelCount = max(Int(streamDescription?.mChannelsPerFrame ?? 2), 1)
+        }
+        try self.init(duration: asset.duration.seconds, sourceSize: videoTrack.naturalSize, sourceFrameRate: videoTrack.nominalFrameRate,
+            sourceAudioChannelCount: audioChannelCount, maxByteCount: maxByteCount)
+    }
+
+    public func withVideoBitRate(scaledBy factor: Double) -> VideoTranscodePlan {
+        let videoBitRate = max(Int(Double(self.videoBitRate) * factor), VideoTranscodePlan.minVideoBitRate)
+        return VideoTranscodePlan(size: size, frameRate: frameRate, videoBitRate: videoBitRate, audioBitRate: audioBitRate, audioChannelCount: audioChannelCount)
+    }
+
+    private static func size(scaling size: CGSize, toLongestEdge longestEdge: CGFloat) -> CGSize {
+        let scale = min(1, longestEdge / max(size.width, size.height, 1))
+        // H.264 requires even dimensions
+        func evenValue(_ value: CGFloat) -> CGFloat { return max(2, (value * scale / 2).rounded(.down) * 2) }
+        return CGSize(width: evenValue(size.width), height: evenValue(size.height))
+    }
+}
+
+// MARK: Encoding
+public protocol VideoEncoder {
+
+    /// Encodes `asset` to an MP4 file at `outputURL` using the given plan. `progress` is called with values between 0 and 1, and
+    /// `isCancelled` is checked between samples; encoding should fail with `VideoTranscodeError.cancelled` once it returns `true`.
+    func encode(_ asset: AVAsset, to outputURL: URL, using plan: VideoTranscodePlan, progress: @escaping (Float) -> Void,
+        isCancelled: @escaping () -> Bool) -> Promise<Void>
+}
+
+/// Encodes H.264 video and AAC audio using `AVAssetReader` and `AVAssetWriter`, which use the hardware encoder where it's
+/// available. Metadata (e.g. location data) isn't copied over.
+public final class AVAssetWriterVideoEncoder : VideoEncoder {
+
+    public init() { }
+
+    public func encode(_ asset: AVAsset, to outputURL: URL, using plan: VideoTranscodePlan, progress: @escaping (Float) -> Void,
+        isCancelled: @escaping () -> Bool) -> Promise<Void> {
+        let reader: AVAssetReader
+        let writer: AVAssetWriter
+        do {
+            reader = try AVAssetReader(asset: asset)
+            writer = try AVAssetWriter(outputURL: outputURL, fileType: .mp4)
+        } catch {
+            return Promise(error: VideoTranscodeError.failed(error))
+        }
+        guard let videoTrack = asset.tracks(withMediaType: .video).first else { return Promise(error: VideoTranscodeError.noVideoTrack) }
+        writer.shouldOptimizeForNetworkUse = true
+        // Video
+        let videoOutput = AVAssetReaderTrackOutput(track: videoTrack, outputSettings: [
+            kCVPixelBufferPixelFormatTypeKey as String : kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange
+        ])
+        videoOutput.alwaysCopiesSampleData = false
+        let videoInput = AVAssetWriterInput(mediaType: .video, outputSettings: [
+            AVVideoCodecKey : AVVideoCodecType.h264,
+            AVVideoWidthKey : Int(plan.size.width),
+            AVVideoHeightKey : Int(plan.size.height),
+            AVVideoScalingModeKey : AVVideoScalingModeResizeAspectFill,
+            AVVideoCompressionPropertiesKey : [
+                AVVideoAverageBitRateKey : plan.videoBitRate,
+                AVVideoExpectedSourceFrameRateKey : plan.frameRate,
+                AVVideoMaxKeyFrameIntervalKey : Int(plan.frameRate * 2),
+                AVVideoProfileLevelKey : AVVideoProfileLevelH264HighAutoLevel
+            ]
+        ])
+        videoInput.expectsMediaDataInRealTime = false
+        videoInput.transform = videoTrack.preferredTransform
+        guard reader.canAdd(videoOutput), writer.canAdd(videoInput) else { return Promise(error: VideoTranscodeError.failed(nil)) }
+        reader.add(videoOutput)
+        writer.add(videoInput)
+        let duration = asset.duration.seconds
+        var pumps = [ SampleBufferPump(output: videoOutput, input: videoInput, label: "AVAssetWriterVideoEncoder.videoQueue",
+            minFrameInterval: 1 / Double(plan.frameRate), progress: { time in
+                guard duration > 0 else { return }
+                progress(Float(min(time / duration, 1)))
+            }) ]
+        // Audio
+        if plan.audioBitRate > 0, let audioTrack = asset.tracks(withMediaType: .audio).first {
+            let audioOutput = AVAssetReaderTrackOutput(track: audioTrack, outputSettings: [
+                AVFormatIDKey : kAudioFormatLinearPCM,
+                AVSampleRateKey : VideoTranscodePlan.audioSampleRate,
+                AVNumberOfChannelsKey : plan.audioChannelCount
+            ])
+            let audioInput = AVAssetWriterInput(mediaType: .audio, outputSettings: [
+                AVFormatIDKey : kAudioFormatMPEG4AAC,
+                AVSampleRateKey : VideoTranscodePlan.audioSampleRate,
+                AVNumberOfChannelsKey : plan.audioChannelCount,
+                AVEncoderBitRateKey : plan.audioBitRate
+            ])
+            audioInput.expectsMediaDataInRealTime = false
+            if reader.canAdd(audioOutput) && writer.canAdd(audioInput) {
+                reader.add(audioOutput)
+                writer.add(audioInput)
+                pumps.append(SampleBufferPump(output: audioOutput, input: audioInput, label: "AVAssetWriterVideoEncoder.audioQueue"))
+            }
+        }
+        guard reader.startReading() else { return Promise(error: VideoTranscodeError.failed(reader.error)) }
+        guard writer.startWriting() else {
+            reader.cancelReading()
+            return Promise(error: VideoTranscodeError.failed(writer.error))
+        }
+        writer.startSession(atSourceTime: .zero)
+        let (promise, seal) = Promise<Void>.pending()
+        let group = DispatchGroup()
+        for pump in pumps {
+            group.enter()
+            pump.start(isCancelled: isCancelled) { group.leave() }
+        }
+        group.notify(queue: DispatchQueue.global(qos: .userInitiated)) {
+            if isCancelled() {
+                reader.cancelReading()
+                writer.cancelWriting()
+                return seal.reject(VideoTranscodeError.cancelled)
+            }
+            guard reader.status != .failed else {
+                writer.cancelWriting()
+                return seal.reject(VideoTranscodeError.failed(reader.error))
+            }
+            writer.finishWriting {
+                if writer.status == .completed {
+                    seal.fulfill(())
+                } else {
+                    seal.reject(VideoTranscodeError.failed(writer.error))
+                }
+            }
+        }
+        return promise
+    }
+}
+
+/// Moves sample buffers from a reader output to a writer input as fast as the writer accepts them, optionally dropping
+/// frames to reduce the frame rate.
+private final class SampleBufferPump {
+    private let output: AVAssetReaderOutput
+    private let input: AVAssetWriterInput
+    private let queue: DispatchQueue
+    private let minFrameInterval: TimeInterval?
+    private let progress: ((TimeInterval) -> Void)?
+    /// Should only be accessed from `queue`.
+    private var nextFrameTime: TimeInterval = -.infinity
+    private var isFinished = false
+
+    /// Frames within this much of their scheduled time are kept, to allow for timestamp jitter.
+    private static let frameTimeTolerance: TimeInterval = 0.001
+
+    init(output: AVAssetReaderOutput, input: AVAssetWriterInput, label: String, minFrameInterval: TimeInterval? = nil,
+        progress: ((TimeInterval) -> Void)? = nil) {
+        self.output = output
+        self.input = input
+        self.queue = DispatchQueue(label: label)
+        self.minFrameInterval = minFrameInterval
+        self.progress = progress
+    }
+
+    func start(isCancelled: @escaping () -> Bool, completion: @escaping () -> Void) {
+        input.requestMediaDataWhenReady(on: queue) {
+            guard !self.isFinished else { return }
+            while self.input.isReadyForMoreMediaData {
+                guard !isCancelled(), let sampleBuffer = self.output.copyNextSampleBuffer() else {
+                    return self.finish(completion: completion)
+                }
+                let time = CMSampleBufferGetPresentationTimeStamp(sampleBuffer).seconds
+                if let minFrameInterval = self.minFrameInterval {
+                    guard time + SampleBufferPump.frameTimeTolerance >= self.nextFrameTime else { continue }
+                    self.nextFrameTime = max(self.nextFrameTime, time) + minFrameInterval
+                }
+                guard self.input.append(sampleBuffer) else { return self.finish(completion: completion) } // The writer failed
+                self.progress?(time)
+            }
+        }
+    }
+
+    private func finish(completion: () -> Void) {
+        isFinished = true
+        input.markAsFinished()
+        completion()
+    }
+}
+
+// MARK: Transcoder
+/// Transcodes a video to an MP4 file that fits within a byte budget, reporting progress along the way.
+///
+/// The output is written to a temporary file next to the destination and only moved into place once it's complete and
+/// within budget, so a cancelled or failed transcode never leaves a partial file behind at the destination.
+@objc
+public final class VideoTranscoder : NSObject {
+    public let asset: AVAsset
+    public let plan: VideoTranscodePlan
+    public let maxByteCount: UInt
+    private let encoder: VideoEncoder
+    private let lock = NSLock()
+    private var _progress: Float = 0
+    private var _isCancelled = false
+
+    /// Between 0 and 1.
+    @objc public var progress: Float {
+        lock.lock(); defer { lock.unlock() }
+        return _progress
+    }
+
+    @objc public var isCancelled: Bool {
+        lock.lock(); defer { lock.unlock() }
+        return _isCancelled
+    }
+
+    /// Throws `VideoTranscodeError.exceedsByteBudget` if the video can't fit within `maxByteCount`.
+    public init(asset: AVAsset, maxByteCount: UInt, encoder: VideoEncoder = AVAssetWriterVideoEncoder()) throws {
+        self.asset = asset
+        self.plan = try VideoTranscodePlan(for: asset, maxByteCount: maxByteCount)
+        self.maxByteCount = maxByteCount
+        self.encoder = encoder
+        super.init()
+    }
+
+    @objc public func cancel() {
+        lock.lock(); defer { lock.unlock() }
+        _isCancelled = true
+    }
+
+    public func transcode(to outputURL: URL) -> Promise<Void> {
+        return transcode(to: outputURL, using: plan, isRetry: false)
+    }
+
+    private func transcode(to outputURL: URL, using plan: VideoTranscodePlan, isRetry: Bool) -> Promise<Void> {
+        let temporaryURL = outputURL.appendingPathExtension("partial")
+        OWSFileSystem.deleteFileIfExists(temporaryURL.path)
+        let span = Metrics.beginSpan("video_transcoder.transcode")
+        let promise = encoder.encode(asset, to: temporaryURL, using: plan, progress: { [weak self] progress in
+            self?.setProgress(progress)
+        }, isCancelled: { [weak self] in
+            return self?.isCancelled ?? true
+        })
+        span?.end(after: promise)
+        return promise.then(on: DispatchQueue.global(qos: .userInitiated)) { _ -> Promise<Void> in
+            let byteCount = OWSFileSystem.fileSize(ofPath: temporaryURL.path)?.uintValue ?? 0
+            Metrics.record("video_transcoder.budget_utilization_percent", value: UInt64(100 * byteCount / max(self.maxByteCount, 1)))
+            guard byteCount <= self.maxByteCount else {
+                OWSFileSystem.deleteFileIfExists(temporaryURL.path)
+                guard !isRetry else { throw VideoTranscodeError.exceedsByteBudget }
+                // The encoder overshot its target bit rate; try once more with a bit rate scaled to fit
+                SNLog("Transcoded video exceeded byte budget (\(byteCount) > \(self.maxByteCount)); retrying at a lower bit rate.")
+                Metrics.increment("video_transcoder.retries")
+                self.setProgress(0)
+                let factor = Double(self.maxByteCount) / Double(byteCount) * VideoTranscodePlan.budgetUtilization
+                return self.transcode(to: outputURL, using: plan.withVideoBitRate(scaledBy: factor), isRetry: true)
+            }
+            try FileManager.default.moveItem(at: temporaryURL, to: outputURL)
+            return Promise.value(())
+        }.recover(on: DispatchQueue.global(qos: .userInitiated)) { error -> Promise<Void> in
+            OWSFileSystem.deleteFileIfExists(temporaryURL.path)
+            throw error
+        }
+    }
+
+    private func setProgress(_ progress: Float) {
+        lock.lock(); defer { lock.unlock() }
+        _progress = progress
+    }
+}
@@ -0,0 +1,92 @@
+#if DEBUG
+import Foundation
+
+extension HTTP {
+
+    /// Simulated network conditions for exercising path building, swarm handling and error handling (e.g. 421 swarm
+    /// changes, 406 clock skew and 502 path failures) against a local snode network. Faults are drawn from a seeded
+    /// generator, so a scenario injects the same sequence of faults each time it's run. Which request gets which fault still
+    /// depends on the order in which requests are made, so runs with concurrent requests aren't guaranteed to be identical.
+    public struct FaultInjection {
+        /// Extra latency added to every request.
+        public var latency: TimeInterval
+        /// The probability that a request is dropped. Dropped requests fail with status code 0, like a timeout would.
+        public var lossRate: Double
+        /// Status codes to fail requests with, along with the probability of each being injected.
+        public var faults: [(statusCode: UInt, probability: Double)]
+        /// If set, only requests to URLs containing this string are affected.
+        public var urlFilter: String?
+
+        fileprivate var generator: SeededGenerator
+
+        public init(latency: TimeInterval = 0, lossRate: Double = 0, faults: [(statusCode: UInt, probability: Double)] = [],
+            urlFilter: String? = nil, seed: UInt64 = 0) {
+            self.latency = latency
+            self.lossRate = lossRate
+            self.faults = faults
+            self.urlFilter = urlFilter
+            self.generator = SeededGenerator(seed: seed)
+        }
+    }
+
+    internal enum InjectedFault {
+        case none
+        case drop
+        case statusCode(UInt)
+    }
+
+    private static let faultInjectionLock = NSLock()
+    private static var _faultInjection: FaultInjection?
+
+    /// The conditions to simulate, or `nil` to leave requests alone.
+    public static var faultInjection: FaultInjection? {
+        get { faultInjectionLock.lock(); defer { faultInjectionLock.unlock() }; return _faultInjection }
+        set { faultInjectionLock.lock(); defer { faultInjectionLock.unlock() }; _faultInjection = newValue }
+    }
+
+    /// Returns the latency to add to the given request and the fault to fail it with, if any.
+    internal static func nextInjectedFault(for url: String) -> (latency: TimeInterval, fault: InjectedFault)? {
+        faultInjectionLock.lock()
+        defer { faultInjectionLock.unlock() }
+        guard var faultInjection = _faultInjection else { return nil }
+        if let urlFilter = faultInjection.urlFilter, !url.contains(urlFilter) { return nil }
+        var fault = InjectedFault.none
+        if faultInjection.generator.nextUnitValue() < faultInjection.lossRate {
+            fault = .drop
+        } else {
+            let value = faultInjection.generator.nextUnitValue()
+            var threshold: Double = 0
+            for (statusCode, probability) in faultInjection.faults {
+                threshold += probability
+                guard value < threshold else { continue }
+                fault = .statusCode(statusCode)
+                break
+            }
+        }
+        _faultInjection = faultInjection // Persist the generator state
+        return (latency: faultInjection.latency, fault: fault)
+    }
+}
+
+/// SplitMix64. Not cryptographically secure; only used to make the sequence of simulated faults reproducible.
+fileprivate struct SeededGenerator {
+    private var state: UInt64
+
+    init(seed: UInt64) {
+        state = seed
+    }
+
+    mutating func next() -> UInt64 {
+        state &+= 0x9E3779B97F4A7C15
+        var z = state
+        z = (z ^ (z >> 30)) &* 0xBF58476D1CE4E5B9
+        z = (z ^ (z >> 27)) &* 0x94D049BB133111EB
+        return z ^ (z >> 31)
+    }
+
+    /// Returns a value in `0..<1`.
+    mutating func nextUnitValue() -> Double {
+        return Double(next() >> 11) / Double(1 << 53)
+    }
+}
+#endif
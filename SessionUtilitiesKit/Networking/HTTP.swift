@@ -153,6 +153,22 @@ public enum HTTP {
                 return seal.reject(Error.invalidJSON)
             }
         }
+        #if DEBUG
+        if let injection = nextInjectedFault(for: url) {
+            DispatchQueue.global(qos: .userInitiated).asyncAfter(deadline: .now() + injection.latency) {
+                switch injection.fault {
+                case .none: task.resume()
+                case .drop:
+                    SNLog("\(verb.rawValue) request to \(url) dropped by fault injection.")
+                    seal.reject(Error.httpRequestFailed(statusCode: 0, json: nil))
+                case .statusCode(let statusCode):
+                    SNLog("\(verb.rawValue) request to \(url) failed with injected status code: \(statusCode).")
+                    seal.reject(Error.httpRequestFailed(statusCode: statusCode, json: nil))
+                }
+            }
+            return promise
+        }
+        #endif
         task.resume()
         return promise
     }
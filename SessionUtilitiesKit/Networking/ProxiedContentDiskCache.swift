@@ -0,0 +1,179 @@
+import Foundation
+
+// A persistent cache of downloaded proxied content, keyed by URL and
+// bounded by the number of bytes on disk. The least recently used
+// files are evicted first.
+//
+// The index is stored alongside the files so that the cache survives
+// relaunches. The files live in the caches directory, so iOS may purge
+// them at any time; entries whose file has gone missing are dropped.
+//
+// This class is thread safe.
+class ProxiedContentDiskCache {
+
+    private struct Entry: Codable {
+        let fileName: String
+        let byteCount: UInt
+        var lastAccessDate: Date
+    }
+
+    let folderPath: String
+    // Called with the URLs of files that were evicted to make room for
+    // a new one. Not called on any particular queue.
+    var onEvict: (([String]) -> Void)?
+    private let maxByteCount: UInt
+    private let lock = NSLock()
+    // URL to entry. Should only be accessed while holding `lock`.
+    private var entries = [String: Entry]()
+    private var totalByteCount: UInt = 0
+    private var isSaveScheduled = false
+    private let saveQueue = DispatchQueue(label: "ProxiedContentDiskCache.saveQueue")
+
+    private static let indexFileName = "index.plist"
+    // Access dates are updated on every hit, so saving the index is
+    // coalesced rather than done after every change.
+    private static let saveDelay: TimeInterval = 2
+
+    private var indexFilePath: String {
+        return (folderPath as NSString).appendingPathComponent(ProxiedContentDiskCache.indexFileName)
+    }
+
+    init(folderPath: String, maxByteCount: UInt) {
+        self.folderPath = folderPath
+        self.maxByteCount = maxByteCount
+
+        loadIndex()
+    }
+
+    // MARK: - Lookups
+
+    // Returns the path of the cached file for the given URL, if any,
+    // and marks it as recently used.
+    func filePath(for url: NSURL) -> String? {
+        guard let key = url.absoluteString else {
+            return nil
+        }
+        lock.lock()
+        guard var entry = entries[key] else {
+            lock.unlock()
+            return nil
+        }
+        let filePath = (folderPath as NSString).appendingPathComponent(entry.fileName)
+        guard FileManager.default.fileExists(atPath: filePath) else {
+            // Purged by the system.
+            entries[key] = nil
+            totalByteCount -= entry.byteCount
+            lock.unlock()
+            scheduleSave()
+            return nil
+        }
+        entry.lastAccessDate = Date()
+        entries[key] = entry
+        lock.unlock()
+        scheduleSave()
+        return filePath
+    }
+
+    // Returns a path in the cache folder that a new file can be
+    // downloaded to before it's added with `insert(filePath:for:byteCount:)`.
+    func newFilePath(fileExtension: String) -> String {
+        let fileName = (NSUUID().uuidString as NSString).appendingPathExtension(fileExtension) ?? NSUUID().uuidString
+        return (folderPath as NSString).appendingPathComponent(fileName)
+    }
+
+    // MARK: - Updating
+
+    // Adds a file that was downloaded to a path returned by `newFilePath(fileExtension:)`
+    // and evicts the least recently used files if the cache is over budget.
+    func insert(filePath: String, for url: NSURL, byteCount: UInt) {
+        guard let key = url.absoluteString else {
+            return
+        }
+        var filePathsToDelete = [String]()
+        var evictedKeys = [String]()
+        lock.lock()
+        if let existingEntry = entries[key] {
+            totalByteCount -= existingEntry.byteCount
+            filePathsToDelete.append((folderPath as NSString).appendingPathComponent(existingEntry.fileName))
+        }
+        entries[key] = Entry(fileName: (filePath as NSString).lastPathComponent, byteCount: byteCount, lastAccessDate: Date())
+        totalByteCount += byteCount
+        if totalByteCount > maxByteCount {
+            let keysByAccessDate = entries.keys.sorted { entries[$0]!.lastAccessDate < entries[$1]!.lastAccessDate }
+            for keyToEvict in keysByAccessDate where keyToEvict != key {
+                guard totalByteCount > maxByteCount else {
+                    break
+                }
+                guard let entry = entries.removeValue(forKey: keyToEvict) else {
+                    continue
+                }
+                totalByteCount -= entry.byteCount
+                filePathsToDelete.append((folderPath as NSString).appendingPathComponent(entry.fileName))
+                evictedKeys.append(keyToEvict)
+            }
+        }
+        let onEvict = self.onEvict
+        lock.unlock()
+
+        // Let the owner know, so that it stops handing out assets for
+        // the evicted files.
+        if !evictedKeys.isEmpty {
+            onEvict?(evictedKeys)
+        }
+        for filePathToDelete in filePathsToDelete {
+            OWSFileSystem.deleteFileIfExists(filePathToDelete)
+        }
+        scheduleSave()
+    }
+
+    // MARK: - Index
+
+    private func loadIndex() {
+        if let data = try? Data(contentsOf: URL(fileURLWithPath: indexFilePath)),
+            let loadedEntries = try? PropertyListDecoder().decode([String: Entry].self, from: data) {
+            entries = loadedEntries
+        }
+        var indexedFileNames = Set<String>()
+        for (key, entry) in entries {
+            let filePath = (folderPath as NSString).appendingPathComponent(entry.fileName)
+            guard FileManager.default.fileExists(atPath: filePath) else {
+                entries[key] = nil
+                continue
+            }
+            indexedFileNames.insert(entry.fileName)
+            totalByteCount += entry.byteCount
+        }
+        // Clean up partial downloads and files that were evicted
+        // before the index could be saved.
+        let fileNames = (try? FileManager.default.contentsOfDirectory(atPath: folderPath)) ?? []
+        for fileName in fileNames where fileName != ProxiedContentDiskCache.indexFileName && !indexedFileNames.contains(fileName) {
+            OWSFileSystem.deleteFileIfExists((folderPath as NSString).appendingPathComponent(fileName))
+        }
+    }
+
+    private func scheduleSave() {
+        lock.lock()
+        defer { lock.unlock() }
+        guard !isSaveScheduled else {
+            return
+        }
+        isSaveScheduled = true
+        saveQueue.asyncAfter(deadline: .now() + ProxiedContentDiskCache.saveDelay) {
+            self.saveIndex()
+        }
+    }
+
+    private func saveIndex() {
+        lock.lock()
+        let entries = self.entries
+        isSaveScheduled = false
+        lock.unlock()
+
+        do {
+            let data = try PropertyListEncoder().encode(entries)
+            try data.write(to: URL(fileURLWithPath: indexFilePath), options: .atomic)
+        } catch {
+            print("Couldn't save proxied content cache index: \(error).")
+        }
+    }
+}
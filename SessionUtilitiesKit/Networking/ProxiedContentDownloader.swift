@@ -6,8 +6,12 @@ import Foundation
 import ObjectiveC
 
 // Stills should be loaded before full GIFs.
+//
+// Background requests are ones that were cancelled when they were
+// nearly done; they're only finished so that the asset ends up in
+// the cache.
 public enum ProxiedContentRequestPriority {
-    case low, high
+    case background, low, high
 }
 
 // MARK: -
@@ -60,54 +64,140 @@ public class ProxiedContentAssetSegment: NSObject {
 
     // This state is accessed off the main thread.
     //
-    // * During downloads it will be accessed on the task delegate queue.
-    // * After downloads it will be accessed on a worker queue. 
-    private var segmentData = Data()
+    // During downloads it will be accessed on the task delegate queue.
+    private var receivedByteCount: UInt = 0
+
+    // Segment data is written straight into the asset file at the
+    // segment's offset as it arrives. If the last two segments overlap,
+    // the overlapping bytes are simply written twice.
+    private let assetFile: ProxiedContentAssetFile
 
     // This state should only be accessed on the main thread.
     public weak var task: URLSessionDataTask?
 
-    init(index: UInt,
-         segmentStart: UInt,
-         segmentLength: UInt,
-         redundantLength: UInt) {
+    // Used to measure throughput. This state should only be accessed
+    // on the main thread.
+    fileprivate var startDate: Date?
+
+    fileprivate init(index: UInt,
+                     segmentStart: UInt,
+                     segmentLength: UInt,
+                     redundantLength: UInt,
+                     assetFile: ProxiedContentAssetFile) {
         self.index = index
         self.segmentStart = segmentStart
         self.segmentLength = segmentLength
         self.redundantLength = redundantLength
+        self.assetFile = assetFile
     }
 
     public func totalDataSize() -> UInt {
-        return UInt(segmentData.count)
+        return receivedByteCount
     }
 
     public func append(data: Data) {
         guard state == .downloading else {
             return
         }
+        // Don't write past the end of the segment; the size check
+        // once the segment completes will fail it instead.
+        guard receivedByteCount + UInt(data.count) <= segmentLength else {
+            receivedByteCount += UInt(data.count)
+            return
+        }
+        guard assetFile.write(data: data, offset: segmentStart + receivedByteCount) else {
+            return
+        }
+        receivedByteCount += UInt(data.count)
+    }
+}
+
+// MARK: -
+
+// The file an asset is downloaded into. It's preallocated once the
+// content length is known, so that segments can be written at their
+// offsets in any order and the asset never has to be held in memory.
+//
+// This class is thread safe.
+fileprivate class ProxiedContentAssetFile {
+
+    let filePath: String
+    private var fileDescriptor: Int32
+    private var isFinished = false
+    private let lock = NSLock()
+
+    init?(filePath: String, length: UInt) {
+        let fileDescriptor = Darwin.open(filePath, O_WRONLY | O_CREAT | O_TRUNC, 0o600)
+        guard fileDescriptor >= 0 else {
+            return nil
+        }
+        guard ftruncate(fileDescriptor, off_t(length)) == 0 else {
+            Darwin.close(fileDescriptor)
+            OWSFileSystem.deleteFileIfExists(filePath)
+            return nil
+        }
+        self.filePath = filePath
+        self.fileDescriptor = fileDescriptor
+    }
 
-        segmentData.append(data)
+    deinit {
+        if fileDescriptor >= 0 {
+            Darwin.close(fileDescriptor)
+        }
     }
 
-    public func mergeData(assetData: inout Data) -> Bool {
-        guard state == .complete else {
+    func write(data: Data, offset: UInt) -> Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        guard fileDescriptor >= 0 else {
             return false
         }
-        guard UInt(segmentData.count) == segmentLength else {
+        return data.withUnsafeBytes { (buffer: UnsafeRawBufferPointer) -> Bool in
+            guard let baseAddress = buffer.baseAddress else {
+                return true
+            }
+            var bytesWritten = 0
+            while bytesWritten < buffer.count {
+                let result = pwrite(fileDescriptor, baseAddress + bytesWritten, buffer.count - bytesWritten, off_t(offset) + off_t(bytesWritten))
+                if result < 0 && errno == EINTR {
+                    continue
+                }
+                guard result > 0 else {
+                    return false
+                }
+                bytesWritten += result
+            }
+            return true
+        }
+    }
+
+    // Closes the file once all of it has been written. Returns false
+    // if the file has already been discarded.
+    func finish() -> Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        guard fileDescriptor >= 0 else {
             return false
         }
+        let result = Darwin.close(fileDescriptor)
+        fileDescriptor = -1
+        isFinished = (result == 0)
+        return isFinished
+    }
 
-        // In some cases the last two segments will overlap.
-        // In that case, we only want to append the non-overlapping
-        // tail of the segment data.
-        let bytesToIgnore = Int(redundantLength)
-        if bytesToIgnore > 0 {
-            let subdata = segmentData.subdata(in: bytesToIgnore..<Int(segmentLength))
-            assetData.append(subdata)
-        } else {
-            assetData.append(segmentData)
+    // Deletes the file, unless it has been finished; finished files
+    // belong to the asset (or disk cache) from then on.
+    func discard() {
+        lock.lock()
+        defer { lock.unlock() }
+        guard !isFinished else {
+            return
         }
-        return true
+        if fileDescriptor >= 0 {
+            Darwin.close(fileDescriptor)
+            fileDescriptor = -1
+        }
+        OWSFileSystem.deleteFileIfExists(filePath)
     }
 }
 
@@ -135,7 +225,8 @@ public enum ProxiedContentAssetRequestState: UInt {
 public class ProxiedContentAssetRequest: NSObject {
 
     let assetDescription: ProxiedContentAssetDescription
-    let priority: ProxiedContentRequestPriority
+    // This state should only be accessed on the main thread.
+    fileprivate(set) var priority: ProxiedContentRequestPriority
     // Exactly one of success or failure should be called once,
     // on the main thread _unless_ this request is cancelled before
     // the request succeeds or fails.
@@ -144,8 +235,14 @@ public class ProxiedContentAssetRequest: NSObject {
     
     var shouldIgnoreSignalProxy = false
     var wasCancelled = false
+    // Whether the request was cancelled, but is being finished in the
+    // background. This state should only be accessed on the main thread.
+    fileprivate var isDetached = false
+    // Used to measure round trip time. This state should only be
+    // accessed on the main thread.
+    fileprivate var contentLengthRequestStartDate: Date?
     // This property is an internal implementation detail of the download process.
-    var assetFilePath: String?
+    fileprivate var assetFile: ProxiedContentAssetFile?
 
     // This state should only be accessed on the main thread.
     private var segments = [ProxiedContentAssetSegment]()
@@ -170,7 +267,9 @@ public class ProxiedContentAssetRequest: NSObject {
         super.init()
     }
 
-    private func segmentSize() -> UInt {
+    // The largest of the standard segment sizes that fits in both
+    // the content and `maxSegmentSize`.
+    private func segmentSize(maxSegmentSize: UInt) -> UInt {
 
         let contentLength = UInt(self.contentLength)
         guard contentLength > 0 else {
@@ -184,7 +283,8 @@ public class ProxiedContentAssetRequest: NSObject {
         let k50KB: UInt = 50 * 1024
         let k10KB: UInt = 10 * 1024
         let k1KB: UInt = 1 * 1024
-        for segmentSize in [k1MB, k500KB, k100KB, k50KB, k10KB, k1KB ] {
+        let maxSegmentSize = max(maxSegmentSize, k1KB)
+        for segmentSize in [k1MB, k500KB, k100KB, k50KB, k10KB, k1KB ] where segmentSize <= maxSegmentSize {
             if contentLength >= segmentSize {
                 return segmentSize
             }
@@ -192,18 +292,24 @@ public class ProxiedContentAssetRequest: NSObject {
         return contentLength
     }
 
-    fileprivate func createSegments(withInitialData initialData: Data) {
-        let segmentLength = segmentSize()
+    // Returns false if the asset file couldn't be created.
+    fileprivate func createSegments(withInitialData initialData: Data, filePath: String, maxSegmentSize: UInt) -> Bool {
+        let segmentLength = segmentSize(maxSegmentSize: maxSegmentSize)
         guard segmentLength > 0 else {
-            return
+            return false
         }
         let contentLength = UInt(self.contentLength)
+        guard let assetFile = ProxiedContentAssetFile(filePath: filePath, length: contentLength) else {
+            return false
+        }
+        self.assetFile = assetFile
 
         // Make the initial segment.
         let assetSegment = ProxiedContentAssetSegment(index: 0,
                                                       segmentStart: 0,
                                                       segmentLength: UInt(initialData.count),
-                                                      redundantLength: 0)
+                                                      redundantLength: 0,
+                                                      assetFile: assetFile)
         // "Download" the initial segment using the initialData.
         assetSegment.state = .downloading
         assetSegment.append(data: initialData)
@@ -225,11 +331,13 @@ public class ProxiedContentAssetRequest: NSObject {
             let assetSegment = ProxiedContentAssetSegment(index: index,
                                                  segmentStart: segmentStart,
                                                  segmentLength: segmentLength,
-                                                 redundantLength: redundantLength)
+                                                 redundantLength: redundantLength,
+                                                 assetFile: assetFile)
             segments.append(assetSegment)
             nextSegmentStart = segmentStart + segmentLength
             index += 1
         }
+        return true
     }
 
     private func firstSegmentWithState(state: ProxiedContentAssetSegmentState) -> ProxiedContentAssetSegment? {
@@ -261,6 +369,14 @@ public class ProxiedContentAssetRequest: NSObject {
         return result
     }
 
+    fileprivate func completedSegmentFraction() -> Double {
+        guard !segments.isEmpty else {
+            return 0
+        }
+        let completedSegmentCount = segments.filter { $0.state == .complete }.count
+        return Double(completedSegmentCount) / Double(segments.count)
+    }
+
     public func areAllSegmentsComplete() -> Bool {
         for segment in segments {
             guard segment.state == .complete else {
@@ -270,43 +386,52 @@ public class ProxiedContentAssetRequest: NSObject {
         return true
     }
 
-    public func writeAssetToFile(downloadFolderPath: String) -> ProxiedContentAsset? {
-
-        var assetData = Data()
+    // The segments have already been written to the asset file, so all
+    // that's left is to check that they're complete and close the file.
+    //
+    // Returns the path of the asset file on success.
+    fileprivate func finishAssetFile() -> String? {
+        guard let assetFile = assetFile, contentLength > 0 else {
+            return nil
+        }
         for segment in segments {
-            guard segment.state == .complete else {
-                return nil
-            }
-            guard segment.totalDataSize() > 0 else {
-                return nil
-            }
-            guard segment.mergeData(assetData: &assetData) else {
+            guard segment.state == .complete,
+                segment.totalDataSize() == segment.segmentLength else {
+                assetFile.discard()
                 return nil
             }
         }
-
-        guard assetData.count == contentLength else {
+        guard assetFile.finish() else {
+            assetFile.discard()
             return nil
         }
+        return assetFile.filePath
+    }
 
-        guard assetData.count > 0 else {
-            return nil
-        }
+    private func discardAssetFile() {
+        assetFile?.discard()
+    }
 
-        let fileExtension = assetDescription.fileExtension
-        let fileName = (NSUUID().uuidString as NSString).appendingPathExtension(fileExtension)!
-        let filePath = (downloadFolderPath as NSString).appendingPathComponent(fileName)
-        do {
-            try assetData.write(to: NSURL.fileURL(withPath: filePath), options: .atomicWrite)
-            let asset = ProxiedContentAsset(assetDescription: assetDescription, filePath: filePath)
-            return asset
-        } catch {
-            return nil
+    // If most of the asset has already been downloaded, the download
+    // is finished in the background rather than thrown away, so that
+    // scrolling past an item doesn't waste the work done for it. The
+    // request is picked up again if the asset is requested again in
+    // the meantime.
+    public func cancel() {
+        if state == .active && completedSegmentFraction() >= 0.5 {
+            isDetached = true
+            priority = .background
+            clearCallbacks()
+            return
         }
+        cancelDownload()
     }
 
-    public func cancel() {
+    // Cancels the request outright, even if it's nearly done.
+    public func cancelDownload() {
+        isDetached = false
         wasCancelled = true
+        discardAssetFile()
         contentLengthTask?.cancel()
         contentLengthTask = nil
         for segment in segments {
@@ -318,6 +443,15 @@ public class ProxiedContentAssetRequest: NSObject {
         clearCallbacks()
     }
 
+    fileprivate func reattach(priority: ProxiedContentRequestPriority,
+                              success:@escaping ((ProxiedContentAssetRequest?, ProxiedContentAsset) -> Void),
+                              failure:@escaping ((ProxiedContentAssetRequest) -> Void)) {
+        isDetached = false
+        self.priority = priority
+        self.success = success
+        self.failure = failure
+    }
+
     private func clearCallbacks() {
         success = nil
         failure = nil
@@ -331,6 +465,7 @@ public class ProxiedContentAssetRequest: NSObject {
     }
 
     public func requestDidFail() {
+        discardAssetFile()
         failure?(self)
 
         // Only one of the callbacks should be called, and only once.
@@ -342,9 +477,10 @@ public class ProxiedContentAssetRequest: NSObject {
 
 // Represents a downloaded asset.
 //
-// The blob on disk is cleaned up when this instance is deallocated,
-// so consumers of this resource should retain a strong reference to
-// this instance as long as they are using the asset.
+// Unless the asset is in a downloader's disk cache, the blob on disk
+// is cleaned up when this instance is deallocated, so consumers of
+// this resource should retain a strong reference to this instance as
+// long as they are using the asset.
 @objc
 public class ProxiedContentAsset: NSObject {
 
@@ -354,13 +490,21 @@ public class ProxiedContentAsset: NSObject {
     @objc
     public let filePath: String
 
+    // Files in the disk cache are owned by the cache.
+    let isInDiskCache: Bool
+
     init(assetDescription: ProxiedContentAssetDescription,
-         filePath: String) {
+         filePath: String,
+         isInDiskCache: Bool = false) {
         self.assetDescription = assetDescription
         self.filePath = filePath
+        self.isInDiskCache = isInDiskCache
     }
 
     deinit {
+        guard !isInDiskCache else {
+            return
+        }
         // Clean up on the asset on disk.
         let filePathCopy = filePath
         DispatchQueue.global().async {
@@ -413,6 +557,14 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
 
     private var downloadFolderPath: String?
 
+    // Finished assets are only kept on disk across launches if this
+    // is non-zero. Subclasses can override it to opt in.
+    open class var maxDiskCacheByteCount: UInt {
+        return 0
+    }
+
+    private var diskCache: ProxiedContentDiskCache?
+
     // Force usage as a singleton
     public required init(downloadFolderName: String) {
         self.downloadFolderName = downloadFolderName
@@ -453,6 +605,9 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
         return session
     }()
 
+    // Assets in the disk cache (if any) are owned by the disk cache
+    // rather than by this in-memory cache.
+    //
     // 100 entries of which at least half will probably be stills.
     // Actual animated GIFs will usually be less than 3 MB so the
     // max size of the cache on disk should be ~150 MB.  Bear in mind
@@ -465,6 +620,16 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
     // list.
     private var assetRequestQueue = [ProxiedContentAssetRequest]()
 
+    // Estimates of the link's throughput (in bytes per second) and
+    // round trip time, used to size segments and to decide how many
+    // requests to run at once. They're exponentially weighted moving
+    // averages, so they follow changes in network conditions.
+    //
+    // This state should only be accessed on the main thread.
+    private var throughputEstimate: Double?
+    private var roundTripTimeEstimate: TimeInterval?
+    private let estimateSmoothingFactor = 0.25
+
     // The success and failure callbacks are always called on main queue.
     //
     // The success callbacks may be called synchronously on cache hit, in
@@ -474,12 +639,20 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
                              success:@escaping ((ProxiedContentAssetRequest?, ProxiedContentAsset) -> Void),
                              failure:@escaping ((ProxiedContentAssetRequest) -> Void),
                              shouldIgnoreSignalProxy: Bool = false) -> ProxiedContentAssetRequest? {
-        if let asset = assetMap.get(key: assetDescription.url) {
+        if let asset = cachedAsset(for: assetDescription) {
             // Synchronous cache hit.
             success(nil, asset)
             return nil
         }
 
+        if let detachedAssetRequest = assetRequestQueue.first(where: { $0.isDetached && $0.assetDescription.url == assetDescription.url
+            && $0.shouldIgnoreSignalProxy == shouldIgnoreSignalProxy }) {
+            // Pick up the download where it was left off.
+            detachedAssetRequest.reattach(priority: priority, success: success, failure: failure)
+            processRequestQueueAsync()
+            return detachedAssetRequest
+        }
+
         // Cache miss.
         //
         // Asset requests are done queued and performed asynchronously.
@@ -497,13 +670,42 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
         return assetRequest
     }
 
+    // Checks the in-memory cache first, then the disk cache.
+    private func cachedAsset(for assetDescription: ProxiedContentAssetDescription) -> ProxiedContentAsset? {
+        if let asset = assetMap.get(key: assetDescription.url) {
+            // Go through the disk cache for assets it owns, so that they're
+            // marked as recently used and aren't handed out once their file
+            // has been evicted or purged.
+            if !asset.isInDiskCache || diskCache?.filePath(for: assetDescription.url) == asset.filePath {
+                Metrics.increment("proxied_content.memory_hits")
+                return asset
+            }
+            assetMap.remove(key: assetDescription.url)
+        }
+        guard let filePath = diskCache?.filePath(for: assetDescription.url) else {
+            return nil
+        }
+        Metrics.increment("proxied_content.disk_hits")
+        let asset = ProxiedContentAsset(assetDescription: assetDescription, filePath: filePath, isInDiskCache: true)
+        assetMap.set(key: assetDescription.url, value: asset)
+        return asset
+    }
+
     public func cancelAllRequests() {
-        self.assetRequestQueue.forEach { $0.cancel() }
+        self.assetRequestQueue.forEach { $0.cancelDownload() }
         self.assetRequestQueue = []
     }
 
     private func segmentRequestDidSucceed(assetRequest: ProxiedContentAssetRequest, assetSegment: ProxiedContentAssetSegment) {
         DispatchQueue.main.async {
+            if let startDate = assetSegment.startDate {
+                // Segments share the link, so scale by the number of
+                // segments that were in flight to estimate its total
+                // throughput.
+                let duration = max(Date().timeIntervalSince(startDate), 0.001)
+                let activeSegmentCount = max(self.downloadingSegmentsCount(), 1)
+                self.updateThroughputEstimate(with: Double(assetSegment.segmentLength) / duration * Double(activeSegmentCount))
+            }
             assetSegment.state = .complete
 
             if !self.tryToCompleteRequest(assetRequest: assetRequest) {
@@ -522,15 +724,20 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
         // try to write the asset to file.
         assetRequest.state = .complete
 
-        // Move write off main thread.
+        // Move file system work off main thread.
         DispatchQueue.global().async {
-            guard let downloadFolderPath = self.downloadFolderPath else {
-                return
-            }
-            guard let asset = assetRequest.writeAssetToFile(downloadFolderPath: downloadFolderPath) else {
+            guard let filePath = assetRequest.finishAssetFile() else {
                 self.segmentRequestDidFail(assetRequest: assetRequest)
                 return
             }
+            let assetDescription = assetRequest.assetDescription
+            let asset: ProxiedContentAsset
+            if let diskCache = self.diskCache {
+                diskCache.insert(filePath: filePath, for: assetDescription.url, byteCount: UInt(assetRequest.contentLength))
+                asset = ProxiedContentAsset(assetDescription: assetDescription, filePath: filePath, isInDiskCache: true)
+            } else {
+                asset = ProxiedContentAsset(assetDescription: assetDescription, filePath: filePath)
+            }
             self.assetRequestDidSucceed(assetRequest: assetRequest, asset: asset)
         }
         return true
@@ -602,7 +809,7 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
             return
         }
 
-        if let asset = assetMap.get(key: assetRequest.assetDescription.url) {
+        if let asset = cachedAsset(for: assetRequest.assetDescription) {
             // Deferred cache hit, avoids re-downloading assets that were
             // downloaded while this request was queued.
 
@@ -615,6 +822,7 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
             // If asset request hasn't yet determined the resource size,
             // try to do so now, by requesting a small initial segment.
             assetRequest.state = .requestingSize
+            Metrics.increment("proxied_content.downloads")
 
             let segmentStart: UInt = 0
             // Vary the initial segment size to obscure the length of the response headers.
@@ -643,6 +851,7 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
             }
 
             assetRequest.contentLengthTask = task
+            assetRequest.contentLengthRequestStartDate = Date()
             task.resume()
         } else {
             // Start a download task.
@@ -674,6 +883,7 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
             task.assetRequest = assetRequest
             task.assetSegment = assetSegment
             assetSegment.task = task
+            assetSegment.startDate = Date()
             task.resume()
         }
 
@@ -738,9 +948,25 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
             return
         }
 
+        Metrics.increment("proxied_content.bytes_downloaded", by: Int64(data.count))
+
         DispatchQueue.main.async {
+            // The initial segment is small, so the time it takes is
+            // dominated by the round trip.
+            if let startDate = assetRequest.contentLengthRequestStartDate {
+                self.updateRoundTripTimeEstimate(with: Date().timeIntervalSince(startDate))
+            }
+            guard let filePath = self.newAssetFilePath(for: assetRequest.assetDescription) else {
+                assetRequest.state = .failed
+                self.assetRequestDidFail(assetRequest: assetRequest)
+                return
+            }
             assetRequest.contentLength = contentLength
-            assetRequest.createSegments(withInitialData: data)
+            guard assetRequest.createSegments(withInitialData: data, filePath: filePath, maxSegmentSize: self.maxSegmentSize()) else {
+                assetRequest.state = .failed
+                self.assetRequestDidFail(assetRequest: assetRequest)
+                return
+            }
             assetRequest.state = .active
 
             if !self.tryToCompleteRequest(assetRequest: assetRequest) {
@@ -754,13 +980,14 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
     // * Need to download the content length.
     // * Need to download at least one of its segments.
     private func popNextAssetRequest() -> ProxiedContentAssetRequest? {
-        let kMaxAssetRequestCount: UInt = 3
+        let kMaxAssetRequestCount: UInt = maxConcurrentRequestCount()
         let kMaxAssetRequestsPerAssetCount: UInt = kMaxAssetRequestCount - 1
 
         // Prefer the first "high" priority request;
-        // fall back to the first "low" priority request.
+        // fall back to the first "low" priority request,
+        // and then to requests being finished in the background.
         var activeAssetRequestsCount: UInt = 0
-        for priority in [ProxiedContentRequestPriority.high, ProxiedContentRequestPriority.low] {
+        for priority in [ProxiedContentRequestPriority.high, ProxiedContentRequestPriority.low, ProxiedContentRequestPriority.background] {
             for assetRequest in assetRequestQueue where assetRequest.priority == priority {
                 switch assetRequest.state {
                 case .waiting:
@@ -802,6 +1029,57 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
         return nil
     }
 
+    // MARK: Scheduling
+
+    private func updateThroughputEstimate(with sample: Double) {
+        if let throughputEstimate = throughputEstimate {
+            self.throughputEstimate = throughputEstimate + estimateSmoothingFactor * (sample - throughputEstimate)
+        } else {
+            throughputEstimate = sample
+        }
+    }
+
+    private func updateRoundTripTimeEstimate(with sample: TimeInterval) {
+        if let roundTripTimeEstimate = roundTripTimeEstimate {
+            self.roundTripTimeEstimate = roundTripTimeEstimate + estimateSmoothingFactor * (sample - roundTripTimeEstimate)
+        } else {
+            roundTripTimeEstimate = sample
+        }
+    }
+
+    private func downloadingSegmentsCount() -> UInt {
+        return assetRequestQueue.reduce(0) { $0 + $1.downloadingSegmentsCount() }
+    }
+
+    // High latency links benefit from more requests in flight, since
+    // each request spends most of its time waiting on the round trip.
+    // Slow links don't; requests just compete for bandwidth and delay
+    // the first frame of every GIF.
+    private func maxConcurrentRequestCount() -> UInt {
+        guard let throughputEstimate = throughputEstimate,
+            let roundTripTimeEstimate = roundTripTimeEstimate else {
+            return 3
+        }
+        let kSlowLinkThroughput: Double = 100 * 1024
+        guard throughputEstimate >= kSlowLinkThroughput else {
+            return 2
+        }
+        let count = 2 + UInt((roundTripTimeEstimate / 0.1).rounded())
+        return min(max(count, 3), 6)
+    }
+
+    // Segments should take long enough to amortize the round trip of
+    // each request, but not so long that a slow link spends ages on a
+    // single segment before anything can be shown.
+    private func maxSegmentSize() -> UInt {
+        guard let throughputEstimate = throughputEstimate else {
+            return UInt.max
+        }
+        let targetDuration = max(0.5, 4 * (roundTripTimeEstimate ?? 0))
+        let perRequestThroughput = throughputEstimate / Double(maxConcurrentRequestCount())
+        return UInt(min(perRequestThroughput * targetDuration, Double(UInt32.max)))
+    }
+
     // MARK: URLSessionDataDelegate
 
     @nonobjc
@@ -818,6 +1096,7 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
             segmentRequestDidFail(assetRequest: assetRequest, assetSegment: assetSegment)
             return
         }
+        Metrics.increment("proxied_content.bytes_downloaded", by: Int64(data.count))
         assetSegment.append(data: data)
     }
 
@@ -859,7 +1138,40 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
 
     // MARK: Temp Directory
 
+    private func newAssetFilePath(for assetDescription: ProxiedContentAssetDescription) -> String? {
+        if let diskCache = diskCache {
+            return diskCache.newFilePath(fileExtension: assetDescription.fileExtension)
+        }
+        guard let downloadFolderPath = downloadFolderPath,
+            let fileName = (NSUUID().uuidString as NSString).appendingPathExtension(assetDescription.fileExtension) else {
+            return nil
+        }
+        return (downloadFolderPath as NSString).appendingPathComponent(fileName)
+    }
+
     public func ensureDownloadFolder() {
+        let maxDiskCacheByteCount = type(of: self).maxDiskCacheByteCount
+        if maxDiskCacheByteCount > 0 {
+            // Cached assets are kept in the caches directory, which
+            // survives relaunches but can still be purged by iOS.
+            let cacheFolderPath = ((OWSFileSystem.cachesDirectoryPath() as NSString)
+                .appendingPathComponent("ProxiedContent") as NSString)
+                .appendingPathComponent(downloadFolderName)
+            if OWSFileSystem.ensureDirectoryExists(cacheFolderPath) {
+                // Don't back up ProxiedContent downloads.
+                OWSFileSystem.protectFileOrFolder(atPath: cacheFolderPath)
+                let diskCache = ProxiedContentDiskCache(folderPath: cacheFolderPath, maxByteCount: maxDiskCacheByteCount)
+                diskCache.onEvict = { [weak self] urls in
+                    DispatchQueue.main.async {
+                        urls.compactMap { NSURL(string: $0) }.forEach { self?.assetMap.remove(key: $0) }
+                    }
+                }
+                self.diskCache = diskCache
+                downloadFolderPath = cacheFolderPath
+                return
+            }
+        }
+
         // We write assets to the temporary directory so that iOS can clean them up.
         // We try to eagerly clean up these assets when they are no longer in use.
 
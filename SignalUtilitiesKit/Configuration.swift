@@ -8,7 +8,54 @@ public final class Configuration : NSObject {
     
     @objc public static func performMainSetup() {
         SNMessagingKit.configure(storage: Storage.shared)
-        SNSnodeKit.configure(storage: Storage.shared)
+        SNSnodeKit.configure(storage: Storage.shared, seedNodePool: getSeedNodePoolOverride())
         SNUtilitiesKit.configure(owsPrimaryStorage: OWSPrimaryStorage.shared(), maxFileSize: UInt(Double(FileServerAPIV2.maxFileSize) / FileServerAPIV2.fileSizeORMultiplier))
+        #if DEBUG
+        HTTP.faultInjection = getFaultInjectionOverride()
+        #endif
     }
+
+    /// In debug builds the seed nodes can be overridden with a comma separated list of URLs in the `SESSION_SEED_NODES`
+    /// environment variable (e.g. `http://localhost:22129`), so that the app can be run against a local snode network.
+    private static func getSeedNodePoolOverride() -> Set<String>? {
+        #if DEBUG
+        guard let rawValue = ProcessInfo.processInfo.environment["SESSION_SEED_NODES"] else { return nil }
+        let seedNodePool = Set(rawValue.split(separator: ",").map { $0.trimmingCharacters(in: .whitespaces) }.filter { !$0.isEmpty })
+        return seedNodePool.isEmpty ? nil : seedNodePool
+        #else
+        return nil
+        #endif
+    }
+
+    #if DEBUG
+    /// In debug builds network faults can be simulated with a comma separated list of settings in the
+    /// `SESSION_FAULT_INJECTION` environment variable, e.g. `latency=0.5,loss=0.05,421=0.1,502=0.1,url=:22129,seed=7`.
+    /// Numeric keys are status codes along with the probability of each being injected. See `HTTP.FaultInjection`.
+    private static func getFaultInjectionOverride() -> HTTP.FaultInjection? {
+        guard let rawValue = ProcessInfo.processInfo.environment["SESSION_FAULT_INJECTION"] else { return nil }
+        var latency: TimeInterval = 0
+        var lossRate: Double = 0
+        var faults: [(statusCode: UInt, probability: Double)] = []
+        var urlFilter: String?
+        var seed: UInt64 = 0
+        for setting in rawValue.split(separator: ",") {
+            let components = setting.split(separator: "=", maxSplits: 1).map { $0.trimmingCharacters(in: .whitespaces) }
+            guard components.count == 2 else { continue }
+            let (key, value) = (components[0], components[1])
+            switch key {
+            case "latency": latency = TimeInterval(value) ?? 0
+            case "loss": lossRate = Double(value) ?? 0
+            case "url": urlFilter = value
+            case "seed": seed = UInt64(value) ?? 0
+            default:
+                guard let statusCode = UInt(key), let probability = Double(value) else {
+                    SNLog("Ignoring invalid fault injection setting: \(setting).")
+                    continue
+                }
+                faults.append((statusCode: statusCode, probability: probability))
+            }
+        }
+        return HTTP.FaultInjection(latency: latency, lossRate: lossRate, faults: faults, urlFilter: urlFilter, seed: seed)
+    }
+    #endif
 }
@@ -1,6 +1,8 @@
-
 extension ConfigurationMessage {
 
+    /// The maximum number of contacts included in a configuration message, to keep the message within the size limit.
+    public static let maxContactCount = 200
+
     public static func getCurrent() -> ConfigurationMessage? {
         let storage = Storage.shared
         guard let user = storage.getUser() else { return nil }
@@ -10,7 +12,6 @@ extension ConfigurationMessage {
         var closedGroups: Set<ClosedGroup> = []
         var openGroups: Set<String> = []
         var contacts: Set<Contact> = []
-        var contactCount = 0
         Storage.read { transaction in
             TSGroupThread.enumerateCollectionObjects(with: transaction) { object, _ in
                 guard let thread = object as? TSGroupThread else { return }
@@ -31,19 +32,20 @@ extension ConfigurationMessage {
                 default: break
                 }
             }
-            var truncatedContacts = storage.getAllContacts()
-            if truncatedContacts.count > 200 { truncatedContacts = Set(Array(truncatedContacts)[0..<200]) }
-            truncatedContacts.forEach { contact in
+            // Filter before truncating so that hidden or blocked contacts don't take up space, and sort so that the same
+            // contacts are included every time
+            let allContacts = storage.getAllContacts().sorted { $0.sessionID < $1.sessionID }
+            for contact in allContacts {
+                guard contacts.count < maxContactCount else { break }
                 let publicKey = contact.sessionID
                 let threadID = TSContactThread.threadID(fromContactSessionID: publicKey)
                 guard let thread = TSContactThread.fetch(uniqueId: threadID, transaction: transaction), thread.shouldBeVisible
-                    && !SSKEnvironment.shared.blockingManager.isRecipientIdBlocked(publicKey) else { return }
+                    && !SSKEnvironment.shared.blockingManager.isRecipientIdBlocked(publicKey) else { continue }
                 let profilePictureURL = contact.profilePictureURL
                 let profileKey = contact.profileEncryptionKey?.keyData
                 let contact = ConfigurationMessage.Contact(publicKey: publicKey, displayName: contact.name ?? publicKey,
                     profilePictureURL: profilePictureURL, profileKey: profileKey)
                 contacts.insert(contact)
-                contactCount += 1
             }
         }
         return ConfigurationMessage(displayName: displayName, profilePictureURL: profilePictureURL, profileKey: profileKey,
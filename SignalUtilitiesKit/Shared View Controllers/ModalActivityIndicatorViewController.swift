@@ -17,6 +17,11 @@ public class ModalActivityIndicatorViewController: OWSViewController {
 
     @objc
     public var wasCancelled: Bool = false
+
+    // Called on the main thread when the user cancels, e.g. to stop the work being waited on.
+    // Should only be set on the main thread.
+    @objc
+    public var onCancel: (() -> Void)?
     
     private lazy var spinner: NVActivityIndicatorView = {
         let result = NVActivityIndicatorView(frame: CGRect.zero, type: .circleStrokeSpin, color: .white, padding: nil)
@@ -171,6 +176,7 @@ public class ModalActivityIndicatorViewController: OWSViewController {
         AssertIsOnMainThread()
 
         wasCancelled = true
+        onCancel?()
 
         dismiss { }
     }
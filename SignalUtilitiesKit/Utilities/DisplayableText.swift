@@ -153,8 +153,26 @@ extension String {
     @objc public let fullText: String
     @objc public let displayText: String
     @objc public let isTextTruncated: Bool
+    // Cheap to compute (it only looks at short texts), so this is done up front.
     @objc public let jumbomojiCount: UInt
 
+    // Running the link detector over the full text is expensive and only needed
+    // when the full text is shown (e.g. in LongTextViewController), so this is
+    // computed on first use. Instances are cached and shared between threads,
+    // hence the lock.
+    @objc public var shouldAllowLinkification: Bool {
+        linkificationLock.lock()
+        defer { linkificationLock.unlock() }
+        if let result = _shouldAllowLinkification {
+            return result
+        }
+        let result = DisplayableText.shouldAllowLinkification(in: fullText)
+        _shouldAllowLinkification = result
+        return result
+    }
+    private let linkificationLock = NSLock()
+    private var _shouldAllowLinkification: Bool?
+
     @objc
     public static let kMaxJumbomojiCount: UInt = 5
     // This value is a bit arbitrary since we don't need to be 100% correct about 
@@ -186,7 +204,8 @@ extension String {
         if string == "" {
             return 0
         }
-        if string.count > Int(kMaxJumbomojiCount * kMaxCharactersPerEmojiCount) {
+        // Unlike `count`, this doesn't walk the entire string
+        if !string.dropFirst(Int(kMaxJumbomojiCount * kMaxCharactersPerEmojiCount)).isEmpty {
             return 0
         }
         guard string.containsOnlyEmoji else {
@@ -211,8 +230,7 @@ extension String {
         return try? NSRegularExpression(pattern: pattern)
     }()
 
-    @objc
-    public lazy var shouldAllowLinkification: Bool = {
+    private class func shouldAllowLinkification(in fullText: String) -> Bool {
         guard let linkDetector: NSDataDetector = DisplayableText.linkDetector else {
             owsFailDebug("linkDetector was unexpectedly nil")
             return false
@@ -258,7 +276,7 @@ extension String {
             }
         }
         return true
-    }()
+    }
 
     // MARK: Filter Methods
 
@@ -276,14 +294,40 @@ extension String {
         return text.replacingOccurrences(of: "%", with: "%%")
     }
 
+    // MARK: Caching
+
+    // Message bodies are immutable, so the result of analysing a text can be shared between every place that displays
+    // it and reused when a conversation is reloaded. The cache is keyed by the text itself and bounded by the
+    // (approximate) number of bytes it holds.
+    @objc
+    public static let kMaxCacheByteCount: Int = 4 * 1024 * 1024
+    private static let cache: NSCache<NSString, DisplayableText> = {
+        let cache = NSCache<NSString, DisplayableText>()
+        cache.totalCostLimit = kMaxCacheByteCount
+        return cache
+    }()
+
     @objc
     public class func displayableText(_ rawText: String) -> DisplayableText {
+        let cacheKey = rawText as NSString
+        if let displayableText = cache.object(forKey: cacheKey) {
+            return displayableText
+        }
+        let displayableText = buildDisplayableText(rawText)
+        // The key, the full text and the display text are all retained by the cache
+        let byteCount = 2 * (cacheKey.length + displayableText.fullText.utf16.count + displayableText.displayText.utf16.count)
+        cache.setObject(displayableText, forKey: cacheKey, cost: byteCount)
+        return displayableText
+    }
+
+    private class func buildDisplayableText(_ rawText: String) -> DisplayableText {
         // Only show up to N characters of text.
         let kMaxTextDisplayLength = 512
         let fullText = rawText.filterStringForDisplay()
         var isTextTruncated = false
         var displayText = fullText
-        if displayText.count > kMaxTextDisplayLength {
+        // Unlike `count`, this doesn't walk the entire string
+        if !displayText.dropFirst(kMaxTextDisplayLength).isEmpty {
             // Trim whitespace before _AND_ after slicing the snipper from the string.
             let snippet = String(displayText.prefix(kMaxTextDisplayLength)).ows_stripped()
             displayText = String(format: NSLocalizedString("OVERSIZE_TEXT_DISPLAY_FORMAT", comment: